@@ -5,26 +5,44 @@
 #include <glm/glm.hpp>
 
 #include <string>
+#include <string.h>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+
+// Typed handle to one of a shader's uniforms. Resolve it once with Shader::uniform<T>(),
+// then set it as often as needed without any name lookups.
+template <typename T>
+struct Uniform
+{
+    int slot; // index into the shader's uniform cache, -1 if the uniform is inactive
+    Uniform() : slot(-1) {}
+    explicit Uniform(int s) : slot(s) {}
+    bool valid() const { return slot >= 0; }
+};
 
 class Shader
 {
 public:
     unsigned int ID;
+    unsigned int uploadsIssued;  // glUniform* calls made
+    unsigned int uploadsSkipped; // sets dropped because the value was already uploaded
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath)
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
         std::string fragmentCode;
+        std::string geometryCode;
         std::ifstream vShaderFile;
         std::ifstream fShaderFile;
+        std::ifstream gShaderFile;
         // ensure ifstream objects can throw exceptions:
         vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
         fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
         try 
         {
             // open files
@@ -40,6 +58,15 @@ public:
             // convert stream into string
             vertexCode = vShaderStream.str();
             fragmentCode = fShaderStream.str();			
+            // if geometry shader path is present, also load a geometry shader
+            if(geometryPath != nullptr)
+            {
+                gShaderFile.open(geometryPath);
+                std::stringstream gShaderStream;
+                gShaderStream << gShaderFile.rdbuf();
+                gShaderFile.close();
+                geometryCode = gShaderStream.str();
+            }
         }
         catch (std::ifstream::failure e)
         {
@@ -61,16 +88,33 @@ public:
         glShaderSource(fragment, 1, &fShaderCode, NULL);
         glCompileShader(fragment);
         checkCompileErrors(fragment, "FRAGMENT");
+        // if geometry shader is given, compile geometry shader
+        unsigned int geometry;
+        if(geometryPath != nullptr)
+        {
+            const char * gShaderCode = geometryCode.c_str();
+            geometry = glCreateShader(GL_GEOMETRY_SHADER);
+            glShaderSource(geometry, 1, &gShaderCode, NULL);
+            glCompileShader(geometry);
+            checkCompileErrors(geometry, "GEOMETRY");
+        }
         // shader Program
         ID = glCreateProgram();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
+        if(geometryPath != nullptr)
+            glAttachShader(ID, geometry);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
         // delete the shaders as they're linked into our program now and no longer necessery
         glDeleteShader(vertex);
         glDeleteShader(fragment);
-
+        if(geometryPath != nullptr)
+            glDeleteShader(geometry);
+        // 3. resolve every active uniform's location up front
+        uploadsIssued = 0;
+        uploadsSkipped = 0;
+        resolveUniforms();
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -78,66 +122,178 @@ public:
     { 
         glUseProgram(ID); 
     }
-    // utility uniform functions
+    // typed uniform handles
+    // ------------------------------------------------------------------------
+    template <typename T>
+    Uniform<T> uniform(const char *name)
+    {
+        int slot = findSlot(name);
+        if (slot < 0)
+        {
+            // not in the active list under this name (e.g. "lights[3]"), ask GL once.
+            // A name GL doesn't know is remembered too, so it isn't asked about again.
+            slot = addSlot(name, glGetUniformLocation(ID, name));
+        }
+        if (slots[slot].location < 0)
+            return Uniform<T>();
+        return Uniform<T>(slot);
+    }
+    // ------------------------------------------------------------------------
+    // upload a value, unless it is the value this uniform already holds. Like the
+    // glUniform* calls it wraps, this applies to the program currently in use.
+    template <typename T>
+    void set(Uniform<T> handle, const T &value)
+    {
+        if (!handle.valid())
+            return;
+        UniformSlot &slot = slots[handle.slot];
+        if (slot.cached && memcmp(slot.value, &value, sizeof(T)) == 0)
+        {
+            uploadsSkipped++;
+            return;
+        }
+        memcpy(slot.value, &value, sizeof(T));
+        slot.cached = true;
+        upload(slot.location, value);
+        uploadsIssued++;
+    }
+    // ------------------------------------------------------------------------
+    void resetCounters()
+    {
+        uploadsIssued = 0;
+        uploadsSkipped = 0;
+    }
+    // utility uniform functions, resolved through the uniform cache
     // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
+    void setBool(const char *name, bool value)
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        set(uniform<int>(name), (int)value); 
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
+    void setInt(const char *name, int value)
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        set(uniform<int>(name), value); 
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
+    void setFloat(const char *name, float value)
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        set(uniform<float>(name), value); 
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string &name, const glm::vec2 &value) const
+    void setVec2(const char *name, const glm::vec2 &value)
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        set(uniform<glm::vec2>(name), value); 
     }
-    void setVec2(const std::string &name, float x, float y) const
+    void setVec2(const char *name, float x, float y)
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        set(uniform<glm::vec2>(name), glm::vec2(x, y)); 
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string &name, const glm::vec3 &value) const
+    void setVec3(const char *name, const glm::vec3 &value)
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        set(uniform<glm::vec3>(name), value); 
     }
-    void setVec3(const std::string &name, float x, float y, float z) const
+    void setVec3(const char *name, float x, float y, float z)
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        set(uniform<glm::vec3>(name), glm::vec3(x, y, z)); 
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string &name, const glm::vec4 &value) const
+    void setVec4(const char *name, const glm::vec4 &value)
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        set(uniform<glm::vec4>(name), value); 
     }
-    void setVec4(const std::string &name, float x, float y, float z, float w) const
+    void setVec4(const char *name, float x, float y, float z, float w)
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        set(uniform<glm::vec4>(name), glm::vec4(x, y, z, w)); 
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string &name, const glm::mat2 &mat) const
+    void setMat2(const char *name, const glm::mat2 &mat)
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        set(uniform<glm::mat2>(name), mat);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string &name, const glm::mat3 &mat) const
+    void setMat3(const char *name, const glm::mat3 &mat)
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        set(uniform<glm::mat3>(name), mat);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string &name, const glm::mat4 &mat) const
+    void setMat4(const char *name, const glm::mat4 &mat)
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        set(uniform<glm::mat4>(name), mat);
     }
 
 private:
+    // one cached uniform: where it lives and the last value uploaded to it
+    struct UniformSlot
+    {
+        std::string name;
+        GLint location;  // -1 for a name the program doesn't have
+        bool cached;
+        unsigned char value[sizeof(glm::mat4)];
+    };
+    std::vector<UniformSlot> slots;
+
+    // the value caches only describe this program, so copies would go stale
+    Shader(const Shader &) = delete;
+    Shader &operator=(const Shader &) = delete;
+
+    // look up every active uniform outside of a uniform block
+    // ------------------------------------------------------------------------
+    void resolveUniforms()
+    {
+        GLint count = 0;
+        GLint maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> name(maxLength + 1);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLint size;
+            GLenum type;
+            glGetActiveUniform(ID, i, (GLsizei)name.size(), NULL, &size, &type, &name[0]);
+            GLint location = glGetUniformLocation(ID, &name[0]);
+            if (location < 0)
+                continue; // lives in a uniform block
+            addSlot(&name[0], location);
+            // arrays are reported as "name[0]", also answer to plain "name"
+            char *bracket = strstr(&name[0], "[0]");
+            if (bracket != NULL)
+            {
+                *bracket = '\0';
+                addSlot(&name[0], location);
+            }
+        }
+    }
+    // ------------------------------------------------------------------------
+    int findSlot(const char *name) const
+    {
+        for (size_t i = 0; i < slots.size(); i++)
+        {
+            if (strcmp(slots[i].name.c_str(), name) == 0)
+                return (int)i;
+        }
+        return -1;
+    }
+    // ------------------------------------------------------------------------
+    int addSlot(const char *name, GLint location)
+    {
+        UniformSlot slot;
+        slot.name = name;
+        slot.location = location;
+        slot.cached = false;
+        slots.push_back(slot);
+        return (int)slots.size() - 1;
+    }
+    // ------------------------------------------------------------------------
+    static void upload(GLint location, int value) { glUniform1i(location, value); }
+    static void upload(GLint location, float value) { glUniform1f(location, value); }
+    static void upload(GLint location, const glm::vec2 &value) { glUniform2fv(location, 1, &value[0]); }
+    static void upload(GLint location, const glm::vec3 &value) { glUniform3fv(location, 1, &value[0]); }
+    static void upload(GLint location, const glm::vec4 &value) { glUniform4fv(location, 1, &value[0]); }
+    static void upload(GLint location, const glm::mat2 &mat) { glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]); }
+    static void upload(GLint location, const glm::mat3 &mat) { glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]); }
+    static void upload(GLint location, const glm::mat4 &mat) { glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]); }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
@@ -0,0 +1,136 @@
+#ifndef ANIMATION_HPP
+#define ANIMATION_HPP
+
+#include <math.h>
+#include <vector>
+
+// Animation as tracks: each drives one value of an entity (a part's pitch, how far it's
+// bobbed up, its yaw) as a function of the time since the track started. How it follows time
+// is a curve, shared by every track that moves the same way, so a track itself is only when
+// it started, its curve and the value it starts from. Nothing is stepped from tick to tick,
+// so a track is where it should be however long the ticks are, and every track is evaluated
+// in one pass over a dense array (see animateTracks()).
+
+static const double TRACK_TWO_PI = 6.28318530717958647692;
+
+// What a track drives
+enum TrackChannel
+{
+	TRACK_PITCH,	// of one part, in place of the entity's pitch
+	TRACK_BOB,		// the height the entity is raised by
+	TRACK_YAW		// the entity's yaw
+};
+
+// How a curve's value follows time t (in seconds since its track started), from base
+enum TrackShape
+{
+	TRACK_SINE,			// base + amplitude * sin(2 pi (rate t + phase))
+	TRACK_RAMP,			// base + rate t, wrapped into [0, amplitude)
+	TRACK_KEYFRAMES		// base + straight between keyframes, looping once past the last
+};
+
+// A value at a moment, for TRACK_KEYFRAMES. The first is at time 0.
+struct Keyframe
+{
+	float time;
+	float value;
+	float slope;	// per second, on to the next keyframe (filled in by World::addKeyframeCurve())
+};
+
+struct AnimationCurve
+{
+	TrackShape shape;
+	float amplitude, rate, phase;
+	int firstKey, numKeys;	// into the keyframe array, TRACK_KEYFRAMES only
+	float length;			// of the loop, the last keyframe's time
+	double perLength;		// 1 / length, or 0 for no loop
+	double sampledStart;	// tracks that started then are at sample this tick (see animateTracks())
+	float sample;
+};
+
+struct AnimationTrack
+{
+	double start;	// when the track started, on the clock it's evaluated against
+	int curve;		// into the curve array
+	float base;
+};
+
+// The value of a keyframe curve's keys at t (not negative)
+inline float sampleKeyframes(const AnimationCurve& curve, const Keyframe* keys, double t)
+{
+	int numKeys = curve.numKeys;
+	if (numKeys == 1 || curve.perLength == 0.0) return keys[0].value;
+
+	// Into the loop, so floats will do; t >= 0, so truncating takes the floor
+	float local = (float)(t - (double)(long long)(t * curve.perLength) * curve.length);
+	if (local >= curve.length) local = 0.0f;
+
+	int ii = 0;
+	while (ii < numKeys - 2 && keys[ii + 1].time <= local) ii++;
+	return keys[ii].value + keys[ii].slope * (local - keys[ii].time);
+}
+
+// A curve's value t seconds in, before a track's base is added
+inline float sampleCurve(const AnimationCurve& curve, const std::vector<Keyframe>& keyframes, double t)
+{
+	switch (curve.shape)
+	{
+	case TRACK_SINE:
+		return (float)(curve.amplitude * sin(TRACK_TWO_PI * (curve.rate * t + curve.phase)));
+	case TRACK_RAMP:
+	{
+		double value = curve.rate * t;
+		return (float)(value - floor(value / curve.amplitude) * curve.amplitude);
+	}
+	case TRACK_KEYFRAMES:
+		if (curve.numKeys == 0) return 0.0f;
+		return sampleKeyframes(curve, &keyframes[curve.firstKey], t);
+	}
+	return 0.0f;
+}
+
+// A track's value, where its curve is at sample
+inline float trackValue(const AnimationTrack& track, const AnimationCurve& curve, float sample)
+{
+	float value = track.base + sample;
+	if (curve.shape == TRACK_RAMP)
+	{
+		if (value >= curve.amplitude) value -= curve.amplitude;
+		else if (value < 0.0f) value += curve.amplitude;
+	}
+	return value;
+}
+
+// A track's value at time on its clock
+inline float evaluateTrack(const AnimationTrack& track, const AnimationCurve& curve,
+	const std::vector<Keyframe>& keyframes, double time)
+{
+	return trackValue(track, curve, sampleCurve(curve, keyframes, time - track.start));
+}
+
+// Evaluate every track at time, into values (one per track). Tracks that started together on
+// the same curve are at the same place on it, so each curve is sampled once for a run of them
+// (entities made at once, like the level's, share all their samples). The values are kept
+// apart from the tracks, so what reads them doesn't pull the tracks through the cache.
+inline void animateTracks(const std::vector<AnimationTrack>& tracks, std::vector<AnimationCurve>& curves,
+	const std::vector<Keyframe>& keyframes, double time, std::vector<float>& values)
+{
+	for (size_t ii = 0; ii < curves.size(); ii++)
+	{
+		curves[ii].sampledStart = -1.0;
+	}
+	values.resize(tracks.size());
+	for (size_t ii = 0; ii < tracks.size(); ii++)
+	{
+		const AnimationTrack& track = tracks[ii];
+		AnimationCurve& curve = curves[track.curve];
+		if (curve.sampledStart != track.start)
+		{
+			curve.sample = sampleCurve(curve, keyframes, time - track.start);
+			curve.sampledStart = track.start;
+		}
+		values[ii] = trackValue(track, curve, curve.sample);
+	}
+}
+
+#endif
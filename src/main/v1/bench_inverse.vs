@@ -0,0 +1,30 @@
+#version 330 core
+// sample2.vs as it was before normal matrices moved to the CPU, kept for --vertex-bench
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in mat4 aInstanceModel;  // per-instance, locations 3-6
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
+
+uniform mat4 model;
+uniform bool instanced;
+
+void main()
+{
+    mat4 partModel = instanced ? aInstanceModel : model;
+    FragPos = vec3(partModel * vec4(aPos, 1.0));
+    Normal = mat3(transpose(inverse(partModel))) * aNormal;  
+    TexCoords = aTexCoords;
+    
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
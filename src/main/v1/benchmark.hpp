@@ -0,0 +1,208 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <math.h>
+#include <cctype>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const unsigned int BENCH_SEED = 1234;	// rand() is seeded with this for every benchmark run
+static const int BENCH_WARMUP_FRAMES = 2;		// not counted: scenery baking, driver warm-up, GPU timers a frame behind
+static const double BENCH_TOLERANCE = 10.0;		// percent worse than the baseline that counts as a regression
+static const double BENCH_NOISE_MS = 0.05;		// time differences below this are never regressions
+
+// What one benchmark frame cost
+struct BenchFrame
+{
+	double frameMs;		// start of the frame to after the swap (or glFinish, headless)
+	double cpuMs;		// start of the frame to just before presenting it
+	double gpuMs;		// GPU time of the shadow, scene and lighting passes (GL_TIME_ELAPSED, a frame behind)
+	int drawCalls;
+	int binds;			// program, VAO and texture binds issued
+	int stateChanges;	// GL binds and state changes that got past the state cache
+	int uniformUploads;
+};
+
+// The value below which p percent of values lie (nearest rank)
+inline double percentile(std::vector<double> values, double p)
+{
+	if (values.empty()) return 0.0;
+	std::sort(values.begin(), values.end());
+	int rank = (int)ceil(p / 100.0 * values.size()) - 1;
+	return values[std::min(std::max(rank, 0), (int)values.size() - 1)];
+}
+
+// Collects the frames of a benchmark run and sums them up as JSON
+class BenchmarkRecorder
+{
+
+private:
+
+	// Fields
+	std::vector<BenchFrame> frames;
+	int skipped;
+
+	static void writeTimes(std::ostream& out, const char* name, const std::vector<double>& values)
+	{
+		double total = 0.0;
+		for (size_t ii = 0; ii < values.size(); ii++) total += values[ii];
+		out << "\t\"" << name << "\": { \"mean\": " << (values.empty() ? 0.0 : total / values.size())
+			<< ", \"p50\": " << percentile(values, 50.0)
+			<< ", \"p95\": " << percentile(values, 95.0)
+			<< ", \"p99\": " << percentile(values, 99.0)
+			<< ", \"max\": " << (values.empty() ? 0.0 : *std::max_element(values.begin(), values.end()))
+			<< " },\n";
+	}
+
+public:
+
+	// Constructor
+	BenchmarkRecorder()
+	{
+		skipped = 0;
+	}
+
+	// Add a frame; the first BENCH_WARMUP_FRAMES are dropped
+	void record(const BenchFrame& frame)
+	{
+		if (skipped < BENCH_WARMUP_FRAMES) skipped++;
+		else frames.push_back(frame);
+	}
+
+	int getCount() { return (int)frames.size(); }
+
+	// Percentiles of the times, and mean counts per frame. options says what was measured
+	// (render options, tick rate), so runs that can't be compared can be told apart.
+	void writeJson(std::ostream& out, const std::string& options)
+	{
+		std::vector<double> frameMs, cpuMs, gpuMs;
+		double drawCalls = 0.0, binds = 0.0, stateChanges = 0.0, uniformUploads = 0.0;
+		for (size_t ii = 0; ii < frames.size(); ii++)
+		{
+			frameMs.push_back(frames[ii].frameMs);
+			cpuMs.push_back(frames[ii].cpuMs);
+			gpuMs.push_back(frames[ii].gpuMs);
+			drawCalls += frames[ii].drawCalls;
+			binds += frames[ii].binds;
+			stateChanges += frames[ii].stateChanges;
+			uniformUploads += frames[ii].uniformUploads;
+		}
+		double count = std::max((double)frames.size(), 1.0);
+
+		out << std::fixed << std::setprecision(4);
+		out << "{\n";
+		out << "\t\"options\": \"" << options << "\",\n";
+		out << "\t\"frames\": " << frames.size() << ",\n";
+		writeTimes(out, "frame_ms", frameMs);
+		writeTimes(out, "cpu_ms", cpuMs);
+		writeTimes(out, "gpu_ms", gpuMs);
+		out << "\t\"per_frame\": { \"draw_calls\": " << drawCalls / count
+			<< ", \"binds\": " << binds / count
+			<< ", \"state_changes\": " << stateChanges / count
+			<< ", \"uniform_uploads\": " << uniformUploads / count << " }\n";
+		out << "}\n";
+	}
+};
+
+// Read back the JSON writeJson() writes: numbers as "section.name" (or "name" at the top),
+// strings likewise. Only that shape is understood; false if the file can't be read.
+inline bool readBenchJson(const std::string& path, std::map<std::string, double>& numbers,
+	std::map<std::string, std::string>& strings)
+{
+	std::ifstream file(path.c_str());
+	if (!file) return false;
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	std::string text = buffer.str();
+
+	std::string section, key;
+	size_t pos = 0;
+	while (pos < text.size())
+	{
+		char c = text[pos];
+		if (c == '"')
+		{
+			size_t end = text.find('"', pos + 1);
+			if (end == std::string::npos) return false;
+			std::string word = text.substr(pos + 1, end - pos - 1);
+			pos = end + 1;
+			while (pos < text.size() && isspace(text[pos])) pos++;
+			if (pos < text.size() && text[pos] == ':') key = word;
+			else if (!key.empty()) strings[section.empty() ? key : section + "." + key] = word;
+		}
+		else if (c == '{')
+		{
+			if (!key.empty()) section = key;
+			key.clear();
+			pos++;
+		}
+		else if (c == '}')
+		{
+			section.clear();
+			key.clear();
+			pos++;
+		}
+		else if (!key.empty() && (isdigit(c) || c == '-'))
+		{
+			char* end;
+			numbers[section.empty() ? key : section + "." + key] = strtod(text.c_str() + pos, &end);
+			pos = end - text.c_str();
+			key.clear();
+		}
+		else pos++;
+	}
+	return true;
+}
+
+// Compare a benchmark run with a baseline one, printing every time and count side by side.
+// Anything worse by more than tolerance percent (and, for times, by BENCH_NOISE_MS) is flagged
+// as a regression. Returns how many there were, or -1 if either file couldn't be read.
+inline int compareBenchmarks(const std::string& baselinePath, const std::string& currentPath,
+	double tolerance, std::ostream& out)
+{
+	std::map<std::string, double> baseline, current;
+	std::map<std::string, std::string> baselineStrings, currentStrings;
+	if (!readBenchJson(baselinePath, baseline, baselineStrings)
+		|| !readBenchJson(currentPath, current, currentStrings))
+	{
+		out << "Couldn't read " << baselinePath << " or " << currentPath << std::endl;
+		return -1;
+	}
+	if (baselineStrings["options"] != currentStrings["options"] || baseline["frames"] != current["frames"])
+	{
+		out << "Warning: the runs differ (" << baselineStrings["options"] << ", " << baseline["frames"]
+			<< " frames against " << currentStrings["options"] << ", " << current["frames"]
+			<< " frames)" << std::endl;
+	}
+
+	int regressions = 0;
+	out << std::fixed << std::setprecision(3);
+	out << std::left << std::setw(28) << "metric" << std::right << std::setw(12) << "baseline"
+		<< std::setw(12) << "current" << std::setw(10) << "change" << std::endl;
+	for (std::map<std::string, double>::iterator it = baseline.begin(); it != baseline.end(); ++it)
+	{
+		if (it->first == "frames" || current.find(it->first) == current.end()) continue;
+		double before = it->second;
+		double after = current[it->first];
+		double change = before != 0.0 ? (after - before) / before * 100.0 : 0.0;
+		bool time = it->first.find("_ms.") != std::string::npos;
+		bool regressed = after > before * (1.0 + tolerance / 100.0)
+			&& (!time || after - before > BENCH_NOISE_MS);
+
+		out << std::left << std::setw(28) << it->first << std::right << std::setw(12) << before
+			<< std::setw(12) << after << std::setw(9) << std::setprecision(1) << change << "%"
+			<< std::setprecision(3) << (regressed ? "  REGRESSION" : "") << std::endl;
+		if (regressed) regressions++;
+	}
+	out << regressions << " regression(s) beyond " << std::setprecision(1) << tolerance << "%" << std::endl;
+	return regressions;
+}
+
+#endif
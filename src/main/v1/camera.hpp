@@ -0,0 +1,136 @@
+#ifndef CAMERA_HPP
+#define CAMERA_HPP
+
+#include <glm/glm.hpp>
+
+#include <math.h>
+
+#include "entity.hpp"
+
+// The player's view. Where the camera stands, its yaw and pitch, and whether it's alive are
+// those of its entity in the World; this holds what only it has: which way it looks, the
+// mouse, and the item it carries in front of it, which moves and turns along.
+struct Camera
+{
+	EntityId entity;
+	EntityId item;				// NO_ENTITY for none
+	glm::vec3 front, up, right;
+	glm::vec3 walkFront;		// front, flattened onto the ground, to walk along
+	float lastX, lastY, sensitivity; // old x & y positions of mouse
+	bool firstMouse;
+};
+
+// A camera at position looking along front, as a new entity
+inline Camera createCamera(World& world, glm::vec3 position, glm::vec3 front, glm::vec3 up,
+	int scrWidth, int scrHeight)
+{
+	Camera camera;
+	camera.entity = world.create(0, position);
+	world.transform(camera.entity).yaw = YAW_DEFAULT;
+	camera.item = NO_ENTITY;
+	camera.front = front;
+	camera.up = up;
+	camera.right = glm::normalize(glm::cross(up, glm::normalize(position)));
+	camera.walkFront = front;
+	camera.sensitivity = SENSITIVITY_DEFAULT;
+	camera.lastX = scrWidth / 2.0f;
+	camera.lastY = scrHeight / 2.0f;
+	camera.firstMouse = true;
+	return camera;
+}
+
+// Carry item, floating in front of the view
+inline void holdItem(World& world, Camera& camera, EntityId item)
+{
+	glm::vec3 offset = glm::vec3(0.1f, -0.1, -0.3f);
+	glm::vec3 position = world.transform(camera.entity).position;
+	camera.item = item;
+	world.transform(item).position = position + offset;
+	world.transform(item).anchor = position;
+}
+
+// Move the camera (and the item) by offset
+inline void moveCamera(World& world, Camera& camera, glm::vec3 offset)
+{
+	Transform& transform = world.transform(camera.entity);
+	transform.position += offset;
+	transform.anchor += offset;
+	if (camera.item != NO_ENTITY)
+	{
+		world.transform(camera.item).position += offset;
+		world.transform(camera.item).anchor += offset;
+	}
+}
+
+// Turn the view (and the item) by the given degrees
+inline void turnCamera(World& world, Camera& camera, float xoffset, float yoffset)
+{
+	// Modify cam angle
+	Transform& transform = world.transform(camera.entity);
+	transform.yaw += xoffset;
+	transform.pitch += yoffset;
+
+	// Update item angle
+	if (camera.item != NO_ENTITY)
+	{
+		Transform& item = world.transform(camera.item);
+		item.yaw -= xoffset;
+		while (item.yaw > 360) item.yaw -= 360;
+		while (item.yaw < 0) item.yaw += 360;
+		if ((item.pitch + yoffset) < 89.0f && (item.pitch + yoffset) > -89.0f) {
+			item.pitch += yoffset;
+		}
+	}
+
+	// Constraints -- ensure we don't flip the direction vector
+	if (transform.pitch > 89.0f)
+	{
+		transform.pitch = 89.0f;
+	}
+	else if (transform.pitch < -89.0f)
+	{
+		transform.pitch = -89.0f;
+	}
+	while (transform.yaw > 360) transform.yaw -= 360;
+	while (transform.yaw < 0) transform.yaw += 360;
+
+	// Update vectors
+	glm::vec3 direction;
+	direction.x = cos(glm::radians(transform.yaw)) * cos(glm::radians(transform.pitch));
+	direction.y = sin(glm::radians(transform.pitch));
+	direction.z = sin(glm::radians(transform.yaw)) * cos(glm::radians(transform.pitch));
+	camera.front = glm::normalize(direction);
+	camera.right = glm::normalize(glm::cross(camera.front, camera.up));
+	camera.walkFront = glm::vec3(camera.front.x, 0.0, camera.front.z);
+}
+
+// Look around as the mouse moves, while alive
+inline void mouseMoved(World& world, Camera& camera, double xpos, double ypos)
+{
+	if (!world.isAlive(camera.entity)) return;
+	if (camera.firstMouse)
+	{
+		camera.lastX = xpos;
+		camera.lastY = ypos;
+		camera.firstMouse = false;
+	}
+
+	// Update coords
+	float xoffset = xpos - camera.lastX;
+	float yoffset = camera.lastY - ypos;
+	camera.lastX = xpos;
+	camera.lastY = ypos;
+
+	// Apply sensitivity
+	turnCamera(world, camera, xoffset * camera.sensitivity, yoffset * camera.sensitivity);
+}
+
+// Put the camera somewhere and point it, dead or alive (e.g. following a script)
+inline void setCameraView(World& world, Camera& camera, glm::vec3 position, float yaw, float pitch)
+{
+	const Transform& transform = world.transform(camera.entity);
+	moveCamera(world, camera, position - transform.position);
+	turnCamera(world, camera, yaw - transform.yaw, pitch - transform.pitch);
+}
+
+#endif
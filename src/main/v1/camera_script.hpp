@@ -0,0 +1,80 @@
+#ifndef CAMERA_SCRIPT_HPP
+#define CAMERA_SCRIPT_HPP
+
+#include <glm/glm.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Where the camera is at one moment of a script, and which way it looks (degrees, as the
+// camera's own yaw and pitch)
+struct CameraKey
+{
+	float time;		// seconds into the run
+	glm::vec3 position;
+	float yaw, pitch;
+};
+
+// A path for the camera to follow instead of the player's input, read from a text file with
+// one key per line:
+//     seconds x y z yaw pitch
+// Keys come in time order; blank lines and lines starting with # are skipped. The camera moves
+// in a straight line from one key to the next, and holds still past the last.
+class CameraScript
+{
+
+private:
+
+	// Fields
+	std::vector<CameraKey> keys;
+
+public:
+
+	// Read the keys in path; false if it can't be read or holds none
+	bool load(const std::string& path)
+	{
+		keys.clear();
+		std::ifstream file(path.c_str());
+		std::string line;
+		while (std::getline(file, line))
+		{
+			std::istringstream fields(line);
+			CameraKey key;
+			if (line.empty() || line[0] == '#') continue;
+			if (fields >> key.time >> key.position.x >> key.position.y >> key.position.z
+				>> key.yaw >> key.pitch)
+			{
+				keys.push_back(key);
+			}
+		}
+		return !keys.empty();
+	}
+
+	bool isEmpty() { return keys.empty(); }
+
+	// Seconds until the last key
+	float getDuration() { return keys.empty() ? 0.0f : keys.back().time; }
+
+	// The camera at time, between the keys either side of it
+	CameraKey at(float time)
+	{
+		size_t next = 0;
+		while (next < keys.size() && keys[next].time <= time) next++;
+		if (next == 0) return keys.front();
+		if (next == keys.size()) return keys.back();
+
+		const CameraKey& from = keys[next - 1];
+		const CameraKey& to = keys[next];
+		float amount = (time - from.time) / (to.time - from.time);
+		CameraKey key;
+		key.time = time;
+		key.position = from.position + (to.position - from.position) * amount;
+		key.yaw = from.yaw + (to.yaw - from.yaw) * amount;
+		key.pitch = from.pitch + (to.pitch - from.pitch) * amount;
+		return key;
+	}
+};
+
+#endif
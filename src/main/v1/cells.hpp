@@ -0,0 +1,144 @@
+#ifndef CELLS_HPP
+#define CELLS_HPP
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "frustum.hpp"
+
+static const int MAX_CELLS = 32; // cells are tracked as bits of an unsigned int
+
+// The level split into cells (rooms, or the area outside) joined by portals (doorways).
+// Each frame the cells that can be seen are found by walking from the camera's cell through
+// every open portal in view. Things are then tagged with the cells they overlap (as a bit
+// mask), and only drawn when one of those cells was reached.
+class CellGraph
+{
+
+private:
+
+	struct Cell
+	{
+		AABB bounds;
+		std::vector<int> portals;
+	};
+
+	// An opening between two cells, which can be shut (e.g. by a door)
+	struct Portal
+	{
+		AABB opening;
+		int cells[2];
+		bool open;
+	};
+
+	// Fields
+	std::vector<Cell> cells;
+	std::vector<Portal> portals;
+	unsigned int visibleMask;
+	int visibleCount;
+
+public:
+
+	// Constructor
+	CellGraph()
+	{
+		visibleMask = ~0u;
+		visibleCount = 0;
+	}
+
+	// Returns the new cell's index, or -1 once MAX_CELLS are in use
+	int addCell(glm::vec3 min, glm::vec3 max)
+	{
+		if ((int)cells.size() >= MAX_CELLS) return -1;
+		Cell cell;
+		cell.bounds = AABB(min, max);
+		cells.push_back(cell);
+		return (int)cells.size() - 1;
+	}
+
+	// Join two cells through an opening, returning the portal's index
+	int addPortal(int cellA, int cellB, glm::vec3 min, glm::vec3 max)
+	{
+		Portal portal;
+		portal.opening = AABB(min, max);
+		portal.cells[0] = cellA;
+		portal.cells[1] = cellB;
+		portal.open = true;
+		portals.push_back(portal);
+		cells[cellA].portals.push_back((int)portals.size() - 1);
+		cells[cellB].portals.push_back((int)portals.size() - 1);
+		return (int)portals.size() - 1;
+	}
+
+	void setPortalOpen(int idx, bool b) { portals[idx].open = b; }
+
+	int getNumCells() const { return (int)cells.size(); }
+	unsigned int getVisibleMask() const { return visibleMask; }
+	int getVisibleCount() const { return visibleCount; }
+
+	// Index of the first cell containing the point, -1 if none does
+	int cellAt(glm::vec3 point) const
+	{
+		for (size_t ii = 0; ii < cells.size(); ii++)
+		{
+			if (cells[ii].bounds.intersects(AABB(point, point))) return (int)ii;
+		}
+		return -1;
+	}
+
+	// Bit mask of the cells a box overlaps; 0 if it lies outside all of them
+	unsigned int overlapMask(const AABB& box) const
+	{
+		unsigned int mask = 0;
+		for (size_t ii = 0; ii < cells.size(); ii++)
+		{
+			if (cells[ii].bounds.intersects(box)) mask |= 1u << ii;
+		}
+		return mask;
+	}
+
+	// Find the cells seen from viewPos. Portals only have to touch the frustum, so this errs
+	// on the side of drawing too much. From outside every cell, everything is visible.
+	void update(glm::vec3 viewPos, const Frustum& frustum)
+	{
+		int start = cellAt(viewPos);
+		if (start < 0)
+		{
+			visibleMask = ~0u;
+			visibleCount = (int)cells.size();
+			return;
+		}
+
+		visibleMask = 1u << start;
+		visibleCount = 1;
+		std::vector<int> frontier;
+		frontier.push_back(start);
+
+		for (size_t next = 0; next < frontier.size(); next++)
+		{
+			Cell& cell = cells[frontier[next]];
+			for (size_t pp = 0; pp < cell.portals.size(); pp++)
+			{
+				Portal& portal = portals[cell.portals[pp]];
+				if (!portal.open) continue;
+				if (frustum.classify(portal.opening) == OUTSIDE) continue;
+
+				int other = portal.cells[0] == frontier[next] ? portal.cells[1] : portal.cells[0];
+				if (visibleMask & (1u << other)) continue;
+
+				visibleMask |= 1u << other;
+				visibleCount++;
+				frontier.push_back(other);
+			}
+		}
+	}
+
+	// Whether something overlapping these cells might be seen this frame
+	bool canSee(unsigned int mask) const
+	{
+		return mask == 0 || (mask & visibleMask) != 0;
+	}
+};
+
+#endif
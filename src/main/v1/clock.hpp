@@ -0,0 +1,14 @@
+#ifndef CLOCK_HPP
+#define CLOCK_HPP
+
+#include <chrono>
+
+// Seconds on a steady clock. Unlike glfwGetTime() it works without GLFW (headless runs have
+// no window, see headless.hpp), and from any thread.
+inline double clockSeconds()
+{
+	return std::chrono::duration<double>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif
@@ -0,0 +1,345 @@
+#ifndef CLUSTERS_HPP
+#define CLUSTERS_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "clock.hpp"
+#include "gl_state.hpp"
+#include "light_range.hpp"
+#include "profiler.hpp"
+#include "uniform_blocks.hpp"
+
+// Screen tiles across and down, and depth slices (spaced exponentially between the near and
+// far planes, so clusters stay roughly cube shaped)
+static const int CLUSTERS_X = 16;
+static const int CLUSTERS_Y = 16;
+static const int CLUSTERS_Z = 24;
+static const int CLUSTER_TILES = CLUSTERS_X * CLUSTERS_Y;
+static const int NUM_CLUSTERS = CLUSTER_TILES * CLUSTERS_Z;
+
+// Texture units the light lists are bound to (sample2.fs reads them as samplerBuffers)
+static const unsigned int POINT_LIGHTS_UNIT = 2;
+static const unsigned int CLUSTER_RANGES_UNIT = 3;
+static const unsigned int CLUSTER_LIGHTS_UNIT = 4;
+
+// Each light goes up as its LightBlock, one RGBA32F texel per vec4
+static const int LIGHT_TEXELS = sizeof(LightBlock) / sizeof(glm::vec4);
+
+// Clustered forward lighting. The view volume is cut into CLUSTERS_X * CLUSTERS_Y screen
+// tiles by CLUSTERS_Z depth slices, and every frame each point light is tested against the
+// view-space bounds of the clusters its sphere of influence (see lightRange()) might touch.
+// The lights, a (first, count) range per cluster and the flattened per-cluster light indices
+// go up in three texture buffers, so a fragment only loops over the lights of its cluster.
+class ClusterGrid
+{
+
+private:
+
+	// Fields
+	// View-space bounds of every cluster, one array per component so four tiles of a slice
+	// can be tested at once. Cluster (x, y, z) is at z * CLUSTER_TILES + y * CLUSTERS_X + x.
+	std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+	float sliceDepths[CLUSTERS_Z + 1];	// distance from the camera to each slice boundary
+	glm::mat4 projection;
+	float nearPlane, farPlane;
+	int width, height;
+
+	std::vector<LightBlock> lights;			// each one's pad0 holds its range
+	std::vector<unsigned int> counts;		// lights per cluster, then where each list ends
+	std::vector<unsigned int> ranges;		// first, count per cluster
+	std::vector<unsigned int> indices;		// light indices, cluster by cluster
+	std::vector<unsigned int> pairs;		// cluster, light, ... as found by build()
+	unsigned int buffers[3];				// lights, ranges, indices
+	unsigned int textures[3];
+	bool simd;
+	double buildTime;
+
+	static void sphereTestScalar(const float* x0, const float* y0, const float* z0,
+		const float* x1, const float* y1, const float* z1, glm::vec3 c, float r2, bool* hits)
+	{
+		for (int ii = 0; ii < CLUSTER_TILES; ii++)
+		{
+			float dx = glm::max(glm::max(x0[ii] - c.x, c.x - x1[ii]), 0.0f);
+			float dy = glm::max(glm::max(y0[ii] - c.y, c.y - y1[ii]), 0.0f);
+			float dz = glm::max(glm::max(z0[ii] - c.z, c.z - z1[ii]), 0.0f);
+			hits[ii] = dx * dx + dy * dy + dz * dz <= r2;
+		}
+	}
+
+#ifdef __SSE__
+	static void sphereTestSSE(const float* x0, const float* y0, const float* z0,
+		const float* x1, const float* y1, const float* z1, glm::vec3 c, float r2, bool* hits)
+	{
+		__m128 cx = _mm_set1_ps(c.x);
+		__m128 cy = _mm_set1_ps(c.y);
+		__m128 cz = _mm_set1_ps(c.z);
+		__m128 radius2 = _mm_set1_ps(r2);
+		__m128 zero = _mm_setzero_ps();
+
+		for (int ii = 0; ii < CLUSTER_TILES; ii += 4)
+		{
+			__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(x0 + ii), cx),
+				_mm_sub_ps(cx, _mm_loadu_ps(x1 + ii))), zero);
+			__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(y0 + ii), cy),
+				_mm_sub_ps(cy, _mm_loadu_ps(y1 + ii))), zero);
+			__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(z0 + ii), cz),
+				_mm_sub_ps(cz, _mm_loadu_ps(z1 + ii))), zero);
+			__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+			int mask = _mm_movemask_ps(_mm_cmple_ps(d2, radius2));
+			hits[ii] = (mask & 1) != 0;
+			hits[ii + 1] = (mask & 2) != 0;
+			hits[ii + 2] = (mask & 4) != 0;
+			hits[ii + 3] = (mask & 8) != 0;
+		}
+	}
+#endif
+
+	// Recompute every cluster's view-space bounds from the current projection. A tile's
+	// corners are unprojected onto the near and far planes, and each slice takes the part of
+	// those edges between its two depths.
+	void computeBounds()
+	{
+		glm::mat4 inverse = glm::inverse(projection);
+		for (int zz = 0; zz <= CLUSTERS_Z; zz++)
+		{
+			sliceDepths[zz] = nearPlane * powf(farPlane / nearPlane, (float)zz / CLUSTERS_Z);
+		}
+
+		for (int yy = 0; yy < CLUSTERS_Y; yy++)
+		{
+			for (int xx = 0; xx < CLUSTERS_X; xx++)
+			{
+				// The tile's four edges, from the near plane to the far plane
+				glm::vec3 nearCorners[4], farCorners[4];
+				for (int cc = 0; cc < 4; cc++)
+				{
+					float ndcX = (float)(xx + (cc & 1)) / CLUSTERS_X * 2.0f - 1.0f;
+					float ndcY = (float)(yy + (cc >> 1)) / CLUSTERS_Y * 2.0f - 1.0f;
+					glm::vec4 n = inverse * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+					glm::vec4 f = inverse * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+					nearCorners[cc] = glm::vec3(n) / n.w;
+					farCorners[cc] = glm::vec3(f) / f.w;
+				}
+
+				for (int zz = 0; zz < CLUSTERS_Z; zz++)
+				{
+					glm::vec3 lo(1e30f), hi(-1e30f);
+					for (int cc = 0; cc < 4; cc++)
+					{
+						for (int ss = 0; ss < 2; ss++)
+						{
+							float depth = sliceDepths[zz + ss];
+							float t = (depth + nearCorners[cc].z) / (nearCorners[cc].z - farCorners[cc].z);
+							glm::vec3 p = glm::mix(nearCorners[cc], farCorners[cc], t);
+							lo = glm::min(lo, p);
+							hi = glm::max(hi, p);
+						}
+					}
+
+					int idx = zz * CLUSTER_TILES + yy * CLUSTERS_X + xx;
+					minX[idx] = lo.x; minY[idx] = lo.y; minZ[idx] = lo.z;
+					maxX[idx] = hi.x; maxY[idx] = hi.y; maxZ[idx] = hi.z;
+				}
+			}
+		}
+	}
+
+	// Slice holding a point this far in front of the camera (clamped to the grid)
+	int sliceOf(float depth)
+	{
+		if (depth <= nearPlane) return 0;
+		int slice = (int)(logf(depth / nearPlane) / logf(farPlane / nearPlane) * CLUSTERS_Z);
+		return glm::clamp(slice, 0, CLUSTERS_Z - 1);
+	}
+
+	void uploadBuffer(int ii, GLenum format, const void* data, size_t size)
+	{
+		// Orphan last frame's contents; an empty buffer still needs some storage to be valid
+		if (buffers[ii] == 0) glGenBuffers(1, &buffers[ii]);
+		glState().bindBuffer(GL_TEXTURE_BUFFER, buffers[ii]);
+		glBufferData(GL_TEXTURE_BUFFER, size > 0 ? size : 16, size > 0 ? data : NULL, GL_STREAM_DRAW);
+
+		// The texture keeps reading the buffer through new storage, so it's only attached once
+		if (textures[ii] == 0)
+		{
+			glGenTextures(1, &textures[ii]);
+			glState().bindTexture(POINT_LIGHTS_UNIT + ii, textures[ii], GL_TEXTURE_BUFFER);
+			glState().activeTexture(POINT_LIGHTS_UNIT + ii);
+			glTexBuffer(GL_TEXTURE_BUFFER, format, buffers[ii]);
+		}
+		glState().bindTexture(POINT_LIGHTS_UNIT + ii, textures[ii], GL_TEXTURE_BUFFER);
+	}
+
+public:
+
+	// Constructor -- GL objects are created on the first upload(); like the uniform blocks
+	// they live as long as the context
+	ClusterGrid()
+		: minX(NUM_CLUSTERS), minY(NUM_CLUSTERS), minZ(NUM_CLUSTERS),
+		maxX(NUM_CLUSTERS), maxY(NUM_CLUSTERS), maxZ(NUM_CLUSTERS),
+		counts(NUM_CLUSTERS + 1), ranges(NUM_CLUSTERS * 2)
+	{
+		nearPlane = 0.0f;
+		farPlane = 0.0f;
+		width = 0;
+		height = 0;
+		for (int ii = 0; ii < 3; ii++)
+		{
+			buffers[ii] = 0;
+			textures[ii] = 0;
+		}
+#ifdef __SSE__
+		simd = true;
+#else
+		simd = false;
+#endif
+		buildTime = 0.0;
+	}
+
+	// Test four clusters at a time with SSE where the compiler supports it
+	void setSimd(bool b)
+	{
+#ifdef __SSE__
+		simd = b;
+#else
+		simd = false;
+#endif
+	}
+
+	// Fit the grid to the projection, its near and far planes and the framebuffer size; the
+	// cluster bounds are only recomputed when one of them changes
+	void setProjection(const glm::mat4& inProjection, float inNearPlane, float inFarPlane, int inWidth, int inHeight)
+	{
+		if (inProjection == projection && inNearPlane == nearPlane && inFarPlane == farPlane
+			&& inWidth == width && inHeight == height) return;
+
+		projection = inProjection;
+		nearPlane = inNearPlane;
+		farPlane = inFarPlane;
+		width = inWidth;
+		height = inHeight;
+		computeBounds();
+	}
+
+	// Assign each light to the clusters its range reaches, seen through view. Lights that
+	// can't brighten anything are dropped; ones that reach everywhere go in every cluster.
+	void build(const std::vector<LightBlock>& inLights, const glm::mat4& view)
+	{
+		PROFILE_ZONE("ClusterGrid::build");
+		double start = clockSeconds();
+		lights.clear();
+		pairs.clear();
+
+		bool hits[CLUSTER_TILES];
+		for (size_t ll = 0; ll < inLights.size(); ll++)
+		{
+			float radius = lightRange(inLights[ll]);
+			if (radius == 0.0f) continue;
+
+			unsigned int index = (unsigned int)lights.size();
+			lights.push_back(inLights[ll]);
+			lights.back().pad0 = radius > 0.0f ? radius : farPlane;
+
+			glm::vec3 center = glm::vec3(view * glm::vec4(inLights[ll].position, 1.0f));
+			int firstSlice = 0;
+			int lastSlice = CLUSTERS_Z - 1;
+			if (radius > 0.0f)
+			{
+				if (-center.z + radius < nearPlane || -center.z - radius > farPlane) continue;
+				firstSlice = sliceOf(-center.z - radius);
+				lastSlice = sliceOf(-center.z + radius);
+			}
+			float r2 = radius > 0.0f ? radius * radius : 1e30f;
+
+			for (int zz = firstSlice; zz <= lastSlice; zz++)
+			{
+				int base = zz * CLUSTER_TILES;
+#ifdef __SSE__
+				if (simd)
+				{
+					sphereTestSSE(&minX[base], &minY[base], &minZ[base],
+						&maxX[base], &maxY[base], &maxZ[base], center, r2, hits);
+				}
+				else
+#endif
+				{
+					sphereTestScalar(&minX[base], &minY[base], &minZ[base],
+						&maxX[base], &maxY[base], &maxZ[base], center, r2, hits);
+				}
+
+				for (int tt = 0; tt < CLUSTER_TILES; tt++)
+				{
+					if (!hits[tt]) continue;
+					pairs.push_back((unsigned int)(base + tt));
+					pairs.push_back(index);
+				}
+			}
+		}
+
+		// Counting sort of the pairs by cluster
+		std::fill(counts.begin(), counts.end(), 0u);
+		for (size_t ii = 0; ii < pairs.size(); ii += 2)
+		{
+			counts[pairs[ii] + 1]++;
+		}
+		for (int ii = 0; ii < NUM_CLUSTERS; ii++)
+		{
+			ranges[ii * 2] = counts[ii];
+			ranges[ii * 2 + 1] = counts[ii + 1];
+			counts[ii + 1] += counts[ii];
+		}
+		indices.resize(pairs.size() / 2);
+		for (size_t ii = 0; ii < pairs.size(); ii += 2)
+		{
+			indices[counts[pairs[ii]]++] = pairs[ii + 1];
+		}
+
+		buildTime = clockSeconds() - start;
+	}
+
+	// Send the lists built for this frame to the GPU, bound to their texture units. Without
+	// any lights sample2.fs never reads them, so nothing is sent.
+	void upload()
+	{
+		if (lights.empty()) return;
+		uploadBuffer(0, GL_RGBA32F, lights.empty() ? NULL : &lights[0], lights.size() * sizeof(LightBlock));
+		uploadBuffer(1, GL_RG32UI, &ranges[0], ranges.size() * sizeof(unsigned int));
+		uploadBuffer(2, GL_R32UI, indices.empty() ? NULL : &indices[0], indices.size() * sizeof(unsigned int));
+	}
+
+	// Bind the lists again (e.g. after something else used the units)
+	void bind()
+	{
+		for (int ii = 0; ii < 3; ii++)
+		{
+			if (textures[ii] != 0) glState().bindTexture(POINT_LIGHTS_UNIT + ii, textures[ii], GL_TEXTURE_BUFFER);
+		}
+	}
+
+	// What sample2.fs needs to find a fragment's cluster
+	ClusterBlock getBlock()
+	{
+		ClusterBlock block;
+		float sliceScale = CLUSTERS_Z / logf(farPlane / nearPlane);
+		block.grid = glm::ivec4(CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z, (int)lights.size());
+		block.scale = glm::vec4((float)width / CLUSTERS_X, (float)height / CLUSTERS_Y,
+			sliceScale, logf(nearPlane) * sliceScale);
+		return block;
+	}
+
+	int getNumLights() { return (int)lights.size(); }
+	int getNumReferences() { return (int)indices.size(); }
+	double getBuildTime() { return buildTime; }
+};
+
+#endif
@@ -0,0 +1,240 @@
+#ifndef DEFERRED_HPP
+#define DEFERRED_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <learnopengl/shader_m.h>
+
+#include <math.h>
+#include <iostream>
+#include <vector>
+
+#include "clusters.hpp"
+#include "frame_stats.hpp"
+#include "gl_state.hpp"
+#include "profiler.hpp"
+#include "shadow_map.hpp"
+#include "uniform_blocks.hpp"
+
+// Texture units the G-buffer is read from in the lighting pass: albedo and specular mask,
+// then normals, then depth (the units below hold the materials and point lights, the ones
+// above the shadows)
+static const unsigned int GBUFFER_UNIT = 5;
+
+// Resolution of the sphere drawn around each point light
+static const int SPHERE_SLICES = 12;
+static const int SPHERE_STACKS = 8;
+
+// Deferred shading. The scene is drawn once into a G-buffer of 12 bytes a pixel: albedo with
+// a specular mask (RGBA8), the normal folded into two 16-bit channels (octahedral encoding)
+// and 24-bit depth, from which the lighting pass rebuilds the position. The main light then
+// shades the whole screen once, and each point light only the pixels inside the sphere its
+// range covers, blended on top. Nothing is drawn forward afterwards, so the depth stays in
+// the G-buffer.
+class DeferredRenderer
+{
+
+private:
+
+	// Fields
+	Shader geometry;	// sample2.vs + gbuffer.fs
+	Shader lighting;	// deferred_light.vs + deferred_light.fs
+	Uniform<int> pointLightPassUniform;
+	Uniform<glm::mat4> inverseViewProjectionUniform;
+	Uniform<glm::vec2> viewportSizeUniform;
+	unsigned int FBO;
+	unsigned int targets[3];	// albedo and specular, normals, depth
+	int width, height;
+	unsigned int VAO_sphere, VBO_sphere, EBO_sphere;
+	int sphereIndices;
+	unsigned int VAO_screen;	// no attributes; the full-screen triangle comes from gl_VertexID
+
+	// (Re)allocate the G-buffer for a width x height framebuffer
+	void createTargets()
+	{
+		glState().bindTexture(GBUFFER_UNIT, targets[0]);
+		glState().activeTexture(GBUFFER_UNIT);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glState().bindTexture(GBUFFER_UNIT + 1, targets[1]);
+		glState().activeTexture(GBUFFER_UNIT + 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16, width, height, 0, GL_RG, GL_UNSIGNED_SHORT, NULL);
+		glState().bindTexture(GBUFFER_UNIT + 2, targets[2]);
+		glState().activeTexture(GBUFFER_UNIT + 2);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT,
+			GL_UNSIGNED_INT, NULL);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, targets[0], 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, targets[1], 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, targets[2], 0);
+		unsigned int attachments[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+		glDrawBuffers(2, attachments);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "G-buffer is incomplete" << std::endl;
+		}
+		glState().bindScreen();
+	}
+
+	// A unit sphere, pushed out so its flat faces still enclose the real one
+	void createSphere()
+	{
+		float grow = 1.0f / (cosf(glm::pi<float>() / SPHERE_STACKS) * cosf(glm::pi<float>() / SPHERE_SLICES));
+		std::vector<glm::vec3> vertices;
+		std::vector<unsigned int> indices;
+		for (int ss = 0; ss <= SPHERE_STACKS; ss++)
+		{
+			float phi = glm::pi<float>() * ss / SPHERE_STACKS;
+			for (int ll = 0; ll <= SPHERE_SLICES; ll++)
+			{
+				float theta = 2.0f * glm::pi<float>() * ll / SPHERE_SLICES;
+				vertices.push_back(grow * glm::vec3(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta)));
+			}
+		}
+		for (int ss = 0; ss < SPHERE_STACKS; ss++)
+		{
+			for (int ll = 0; ll < SPHERE_SLICES; ll++)
+			{
+				unsigned int a = ss * (SPHERE_SLICES + 1) + ll;
+				unsigned int b = a + SPHERE_SLICES + 1;
+				unsigned int quad[] = {a, a + 1, b, b, a + 1, b + 1}; // outward facing, counter-clockwise
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+		sphereIndices = (int)indices.size();
+
+		glGenVertexArrays(1, &VAO_sphere);
+		glGenBuffers(1, &VBO_sphere);
+		glGenBuffers(1, &EBO_sphere);
+		glState().bindVertexArray(VAO_sphere);
+		glState().bindBuffer(GL_ARRAY_BUFFER, VBO_sphere);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), &vertices[0], GL_STATIC_DRAW);
+		glState().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_sphere);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0],
+			GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+		glEnableVertexAttribArray(0);
+		glState().bindVertexArray(0);
+	}
+
+public:
+
+	DeferredRenderer(const DeferredRenderer&) = delete;
+	DeferredRenderer& operator=(const DeferredRenderer&) = delete;
+
+	// Constructor -- both passes read the camera, light and material from blocks
+	DeferredRenderer(UniformBlocks& blocks)
+		: geometry("./sample2.vs", "./gbuffer.fs"),
+		lighting("./deferred_light.vs", "./deferred_light.fs")
+	{
+		blocks.bind(geometry);
+		blocks.bind(lighting);
+
+		glState().useProgram(geometry.ID);
+		geometry.setInt("diffuseMap", 0);
+		geometry.setInt("specularMap", 1);
+		geometry.setBool("instanced", false);
+
+		glState().useProgram(lighting.ID);
+		lighting.setInt("gAlbedoSpec", GBUFFER_UNIT);
+		lighting.setInt("gNormal", GBUFFER_UNIT + 1);
+		lighting.setInt("gDepth", GBUFFER_UNIT + 2);
+		lighting.setInt("pointLights", POINT_LIGHTS_UNIT);
+		lighting.setInt("staticShadows", SHADOW_UNIT);
+		lighting.setInt("dynamicShadows", SHADOW_UNIT + 1);
+		pointLightPassUniform = lighting.uniform<int>("pointLightPass");
+		inverseViewProjectionUniform = lighting.uniform<glm::mat4>("inverseViewProjection");
+		viewportSizeUniform = lighting.uniform<glm::vec2>("viewportSize");
+
+		glGenFramebuffers(1, &FBO);
+		glGenTextures(3, targets);
+		for (int ii = 0; ii < 3; ii++)
+		{
+			glState().bindTexture(GBUFFER_UNIT + ii, targets[ii]);
+			glState().activeTexture(GBUFFER_UNIT + ii);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		}
+		width = 0;
+		height = 0;
+
+		createSphere();
+		glGenVertexArrays(1, &VAO_screen);
+	}
+
+	~DeferredRenderer()
+	{
+		glDeleteFramebuffers(1, &FBO);
+		for (int ii = 0; ii < 3; ii++)
+		{
+			glState().deleteTexture(targets[ii]);
+		}
+		glState().deleteVertexArray(VAO_sphere);
+		glState().deleteVertexArray(VAO_screen);
+		glState().deleteBuffer(VBO_sphere);
+		glState().deleteBuffer(EBO_sphere);
+	}
+
+	// Shader the render queue should draw the scene with while filling the G-buffer
+	Shader& getGeometryShader() { return geometry; }
+
+	// Start filling the G-buffer, matching a framebuffer of the given size
+	void beginGeometry(int inWidth, int inHeight)
+	{
+		if (inWidth != width || inHeight != height)
+		{
+			width = inWidth;
+			height = inHeight;
+			createTargets();
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
+
+	// Light the G-buffer into the default framebuffer, with the main light and the first
+	// numPointLights point lights uploaded by the cluster grid
+	void light(FrameStats& stats, const glm::mat4& viewProjection, int numPointLights)
+	{
+		PROFILE_ZONE("DeferredRenderer::light");
+		glState().bindScreen();
+		for (int ii = 0; ii < 3; ii++)
+		{
+			glState().bindTexture(GBUFFER_UNIT + ii, targets[ii]);
+		}
+		glState().useProgram(lighting.ID);
+		lighting.set(inverseViewProjectionUniform, glm::inverse(viewProjection));
+		lighting.set(viewportSizeUniform, glm::vec2((float)width, (float)height));
+		glState().disable(GL_DEPTH_TEST);
+
+		// Main light, everywhere
+		lighting.set(pointLightPassUniform, 0);
+		glState().bindVertexArray(VAO_screen);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		stats.drawCalls++;
+
+		// Point lights, added inside their spheres. Only back faces are drawn, so each pixel
+		// is lit once per light even with the camera inside the sphere.
+		if (numPointLights > 0)
+		{
+			lighting.set(pointLightPassUniform, 1);
+			glState().enable(GL_BLEND);
+			glBlendFunc(GL_ONE, GL_ONE);
+			glState().enable(GL_CULL_FACE);
+			glCullFace(GL_FRONT);
+
+			glState().bindVertexArray(VAO_sphere);
+			glDrawElementsInstanced(GL_TRIANGLES, sphereIndices, GL_UNSIGNED_INT, (void*)0, numPointLights);
+			stats.drawCalls++;
+
+			glCullFace(GL_BACK);
+			glState().disable(GL_CULL_FACE);
+			glState().disable(GL_BLEND);
+		}
+
+		glState().enable(GL_DEPTH_TEST);
+	}
+};
+
+#endif
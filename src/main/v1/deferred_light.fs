@@ -0,0 +1,149 @@
+#version 330 core
+out vec4 FragColor;
+
+// Lighting pass of deferred shading: the main light over the whole screen, or one point
+// light inside its sphere. Each is added to what's there already.
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
+
+layout (std140) uniform Light
+{
+    vec3 position;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+	float constant;
+	float linear;
+	float quadratic;
+	float shadowFar; // 0 when it casts no shadows
+} light;
+
+layout (std140) uniform Material
+{
+    float shininess;
+} material;
+
+flat in int LightIndex; // into pointLights, or -1 for the main light
+
+// The G-buffer (see gbuffer.fs)
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+uniform mat4 inverseViewProjection;
+uniform vec2 viewportSize;
+
+uniform samplerBuffer pointLights; // one LightBlock per 5 texels
+const int LIGHT_TEXELS = 5;
+
+struct PointLight
+{
+    vec3 position;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+	float constant;
+	float linear;
+	float quadratic;
+};
+
+vec3 FragPos; // rebuilt from depth in main()
+
+// Phong lighting from one light, fading with distance; lit is 0 where it's in shadow (as in sample2.fs)
+vec3 shade(PointLight source, vec3 norm, vec3 viewDir, vec3 diffuseColor, vec3 specularColor,
+    float lit)
+{
+    // ambient
+    vec3 ambient = source.ambient * diffuseColor;
+  	
+    // diffuse 
+    vec3 lightDir = normalize(source.position - FragPos);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = source.diffuse * diff * diffuseColor;  
+    
+    // specular
+    vec3 reflectDir = reflect(-lightDir, norm);  
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    vec3 specular = source.specular * spec * specularColor;
+
+	// attenuation
+    float distance    = length(source.position - FragPos);
+    float attenuation = 1.0 / (
+		source.constant + source.linear * distance + source.quadratic * (distance * distance)
+	);    
+
+    ambient  	*= attenuation;  
+    diffuse 	*= attenuation * lit;
+    specular 	*= attenuation * lit;   
+ 
+    return ambient + diffuse + specular;
+}
+
+// Shadow cubes of the main light (see shadow_map.hpp): the distance to the nearest static
+// and moving caster in each direction, over light.shadowFar
+uniform samplerCube staticShadows;
+uniform samplerCube dynamicShadows;
+
+// Slack for depth precision and for the static cube being drawn from up to 0.1 away
+const float SHADOW_BIAS = 0.15;
+
+// 1 where the main light reaches the fragment, 0 where something nearer to it is in the way
+float mainLightVisible()
+{
+    if (light.shadowFar <= 0.0) return 1.0;
+
+    vec3 fromLight = FragPos - light.position;
+    float closest = min(texture(staticShadows, fromLight).r, texture(dynamicShadows, fromLight).r);
+    return length(fromLight) - SHADOW_BIAS > closest * light.shadowFar ? 0.0 : 1.0;
+}
+
+PointLight fetchLight(int index)
+{
+    int base = index * LIGHT_TEXELS;
+    vec4 specularConstant = texelFetch(pointLights, base + 3);
+    vec4 falloff = texelFetch(pointLights, base + 4);
+    return PointLight(
+        texelFetch(pointLights, base).xyz, texelFetch(pointLights, base + 1).xyz,
+        texelFetch(pointLights, base + 2).xyz, specularConstant.xyz,
+        specularConstant.w, falloff.x, falloff.y
+    );
+}
+
+// Unfold a normal written by gbuffer.fs
+vec3 decodeNormal(vec2 f)
+{
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    if (depth == 1.0) discard; // nothing was drawn here
+
+    vec4 ndc = vec4(gl_FragCoord.xy / viewportSize, depth, 1.0) * 2.0 - 1.0;
+    vec4 world = inverseViewProjection * ndc;
+    FragPos = world.xyz / world.w;
+
+    vec4 albedoSpec = texelFetch(gAlbedoSpec, pixel, 0);
+    vec3 norm = decodeNormal(texelFetch(gNormal, pixel, 0).xy * 2.0 - 1.0);
+    vec3 viewDir = normalize(viewPos - FragPos);
+
+    PointLight source = LightIndex < 0
+        ? PointLight(light.position, light.ambient, light.diffuse, light.specular,
+            light.constant, light.linear, light.quadratic)
+        : fetchLight(LightIndex);
+    float lit = LightIndex < 0 ? mainLightVisible() : 1.0;
+    FragColor = vec4(shade(source, norm, viewDir, albedoSpec.rgb, vec3(albedoSpec.a), lit), 1.0);
+}
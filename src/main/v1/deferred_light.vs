@@ -0,0 +1,35 @@
+#version 330 core
+layout (location = 0) in vec3 aPos; // unit sphere
+
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
+
+// Point lights as sorted into clusters; the first texel of each is its position and range
+uniform samplerBuffer pointLights;
+const int LIGHT_TEXELS = 5;
+
+uniform bool pointLightPass;
+
+flat out int LightIndex;
+
+void main()
+{
+    if (pointLightPass)
+    {
+        // A sphere just big enough for the light's reach, one instance per light
+        vec4 positionRange = texelFetch(pointLights, gl_InstanceID * LIGHT_TEXELS);
+        LightIndex = gl_InstanceID;
+        gl_Position = projection * view * vec4(positionRange.xyz + aPos * positionRange.w, 1.0);
+    }
+    else
+    {
+        // One triangle covering the screen, made up from the vertex number
+        LightIndex = -1;
+        vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+        gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+    }
+}
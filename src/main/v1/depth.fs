@@ -0,0 +1,7 @@
+#version 330 core
+
+// Depth pre-pass, drawn with sample2.vs: only the depth buffer is written, so there is
+// nothing to shade
+void main()
+{
+}
@@ -0,0 +1,124 @@
+#ifndef ECS_BENCH_HPP
+#define ECS_BENCH_HPP
+
+#include <glm/glm.hpp>
+
+#include <stdlib.h>
+#include <iomanip>
+#include <iostream>
+
+#include "clock.hpp"
+#include "entity.hpp"
+#include "snapshot.hpp"
+#include "systems.hpp"
+
+static const int ECS_BENCH_TICKS = 20;			// ticks timed per world size
+static const int ECS_BENCH_MAX = 100000;
+static const float ECS_BENCH_AREA = 400.0f;		// entities are scattered over a square this wide
+static const float ECS_BENCH_DT = 1.0f / 60.0f;
+
+// A world of count entities like the level's, the same ones on every run: a quarter are
+// bobbing, spinning pickups, the rest chasers with four swinging limbs after a target too far
+// away to reach
+inline void fillBenchWorld(World& world, int count)
+{
+	static glm::vec3 limbScales[] = {
+		glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(0.6f, 0.8f, 0.3f), glm::vec3(0.2f, 0.7f, 0.2f),
+		glm::vec3(0.2f, 0.7f, 0.2f), glm::vec3(0.2f, 0.8f, 0.2f), glm::vec3(0.2f, 0.8f, 0.2f)
+	};
+	static glm::vec3 limbPositions[] = {
+		glm::vec3(0.0f, 1.8f, 0.0f), glm::vec3(0.0f, 1.2f, 0.0f), glm::vec3(-0.4f, 1.2f, 0.0f),
+		glm::vec3(0.4f, 1.2f, 0.0f), glm::vec3(-0.15f, 0.4f, 0.0f), glm::vec3(0.15f, 0.4f, 0.0f)
+	};
+	static glm::vec3 boxScale[] = { glm::vec3(0.3f, 0.3f, 0.3f) };
+	static glm::vec3 boxPosition[] = { glm::vec3(0.0f, 0.0f, 0.0f) };
+	static unsigned int textures[] = { 0, 0 };
+
+	srand(1234);
+	world.clear();
+	int chaserModel = world.addModel(limbScales, limbPositions, 6, textures, 2);
+	int pickupModel = world.addModel(boxScale, boxPosition, 1, textures, 2);
+	int swingForward = addSwingCurve(world, 600.0f);
+	int swingBack = addSwingCurve(world, -600.0f);
+	int bobCurve = addBobCurve(world);
+	int spinCurve = addSpinCurve(world);
+	EntityId target = world.create(0, glm::vec3(0.0f, 1.0f, ECS_BENCH_AREA * 100.0f));
+
+	for (int ii = 0; ii < count; ii++)
+	{
+		glm::vec3 position(
+			(rand() / (float)RAND_MAX - 0.5f) * ECS_BENCH_AREA,
+			0.5f,
+			(rand() / (float)RAND_MAX - 0.5f) * ECS_BENCH_AREA
+		);
+		if (ii % 4 == 0)
+		{
+			EntityId pickup = world.create(HAS_PICKUP | HAS_ANIMATION, position);
+			world.setModel(pickup, pickupModel);
+			addBob(world, pickup, bobCurve);
+			addSpin(world, pickup, spinCurve);
+		}
+		else
+		{
+			EntityId chaser = world.create(HAS_CHASE, position);
+			world.setModel(chaser, chaserModel);
+			world.chase(chaser).target = target;
+			world.chase(chaser).speed = 3.0f;
+			world.chase(chaser).reach = 1.0f;
+			addSwing(world, chaser, 2, swingForward);
+			addSwing(world, chaser, 3, swingBack);
+			addSwing(world, chaser, 4, swingForward);
+			addSwing(world, chaser, 5, swingBack);
+		}
+	}
+}
+
+// Time a tick of the systems (animation, chasing, finding the nearest pickup) and a snapshot
+// of every entity, for worlds of 1000 up to ECS_BENCH_MAX entities (run with --ecs-bench).
+// Per entity, the times should stay about flat as the world grows.
+inline void runEcsBenchmark(std::ostream& out)
+{
+	World world;
+	FrameSnapshot frame;
+
+	out << "Entity systems, " << ECS_BENCH_TICKS << " ticks per row (ms per tick, ns per entity)"
+		<< std::endl;
+	out << std::setw(10) << "entities" << std::setw(10) << "update" << std::setw(10) << "ns"
+		<< std::setw(10) << "snapshot" << std::setw(10) << "ns" << std::setw(10) << "parts" << std::endl;
+
+	for (int count = 1000; count <= ECS_BENCH_MAX; count *= 10)
+	{
+		fillBenchWorld(world, count);
+		double updateTime = 0.0, snapshotTime = 0.0;
+
+		for (int tt = 0; tt <= ECS_BENCH_TICKS; tt++)
+		{
+			double start = clockSeconds();
+			animationSystem(world, ECS_BENCH_DT);
+			chaseSystem(world, ECS_BENCH_DT);
+			pickupSystem(world, glm::vec3(0.0f, 0.9f, 0.0f), 2.0f);
+			double updated = clockSeconds();
+
+			frame.clear();
+			frame.cameraPos = glm::vec3(0.0f, 0.9f, 0.0f);
+			frame.lodScale = 0.0f;
+			snapshotSystem(world, frame, NO_ENTITY);
+			double snapshotted = clockSeconds();
+
+			// The first tick warms up, and isn't counted
+			if (tt == 0) continue;
+			updateTime += updated - start;
+			snapshotTime += snapshotted - updated;
+		}
+
+		double perTick = 1e3 / ECS_BENCH_TICKS, perEntity = 1e9 / ECS_BENCH_TICKS / count;
+		out << std::fixed << std::setprecision(3)
+			<< std::setw(10) << count
+			<< std::setw(10) << updateTime * perTick << std::setw(10) << std::setprecision(1) << updateTime * perEntity
+			<< std::setw(10) << std::setprecision(3) << snapshotTime * perTick
+			<< std::setw(10) << std::setprecision(1) << snapshotTime * perEntity
+			<< std::setw(10) << frame.partModels.size() << std::endl;
+	}
+}
+
+#endif
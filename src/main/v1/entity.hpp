@@ -1,451 +1,371 @@
-#include <glm/glm.hpp>
-#include <GLFW/glfw3.h>
-#include <list>
-
-#include <stdlib.h>
-#include <math.h>
-#include <map>
-#include <tuple>
+#ifndef ENTITY_HPP
+#define ENTITY_HPP
 
+#include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-#include <learnopengl/shader_m.h> 
+#include <vector>
+
+#include "animation.hpp"
 
 #define PI 3.14159265
 
 // Constants
 static const float YAW_DEFAULT 			= -90.0f;
 static const float PITCH_DEFAULT 		= 0.0f;
-static const float SPD_DEFAULT			= 2.5f;
 static const float SENSITIVITY_DEFAULT 	= 0.05f;
-static const float ANIMATION_SPEED 		= 6.0f;
-
-// Abstract description of a "thing" in the world
-class Entity 
+static const float ANIMATION_SPEED 		= 360.0f;	// degrees a second pickups spin and bob through
+static const float PITCH_ANIMATION_LIMIT	= 30.0f;	// degrees a pitch animation swings either way
+static const float LOD_HYSTERESIS		= 0.1f; // fraction of a switch distance to go past before switching
+
+// Entities are numbers; what they are is the components stored for them in a World. The
+// behaviour that used to live in classes for the camera, pickups and the enemy works on
+// those in bulk, one system at a time (see systems.hpp and camera.hpp).
+typedef unsigned int EntityId;
+static const EntityId NO_ENTITY = 0xffffffff;
+
+// Which components an entity has, one bit each
+enum ComponentBits
 {
+	HAS_TRANSFORM	= 1 << 0,	// every entity
+	HAS_MODEL		= 1 << 1,
+	HAS_ANIMATION	= 1 << 2,
+	HAS_CHASE		= 1 << 3,
+	HAS_PICKUP		= 1 << 4,
+	IS_STATIC		= 1 << 5	// never moves, so it's baked into the static batch
+};
 
-protected:
-
-	// Fields
-	glm::vec3 ePos, eDir, eFront, eUp, eRight, ancor; // ancor to rotate on
+// One version of a model, and from how far away it is used
+struct ModelLod
+{
 	glm::vec3 *scales;
 	glm::vec3 *positions;
+	int numModels;
+	float distance;
+};
+
+// A model any number of entities can show: the full one, then coarser ones further and
+// further out, and its textures
+struct Model
+{
+	std::vector<ModelLod> lods;
 	unsigned int *textures;
-	int numTextures, numModels;
-	float spd, yaw, pitch, roll;
-	bool alive, visible;
-	std::map<int, std::tuple<float, float>> pitchAnimation; //<model idx, amount to increment>
-	
-	// Helpers
-	glm::vec3 calcDirection() 
-	{
-		return glm::normalize(ePos - glm::vec3(0.0f, 0.0f, 0.0f));
-	}
-	glm::vec3 calcRight()
-	{
-		return glm::normalize(glm::cross(eUp, eDir));
-	}
+	int numTextures;
+};
 
-public:
+// Where an entity is and how it's turned. It turns about its anchor, which is where it is,
+// except for something held (see Camera).
+struct Transform
+{
+	glm::vec3 position, anchor;
+	float yaw, pitch, roll;
+};
 
-	// Constructor with vectors
-	Entity(glm::vec3 inPos, glm::vec3 inFront, glm::vec3 inUp) 
-	{
-		alive = true;
-		visible = true;
-		ePos = inPos;
-		eFront = inFront;
-		eUp = inUp;
-		eDir = calcDirection();
-		eRight = calcRight();
-		ancor = ePos;
-
-		textures = NULL; //todo
-
-		spd = SPD_DEFAULT;
-
-		yaw = 0.0f;
-		pitch = PITCH_DEFAULT;
-		roll = 0.0f;
-	}
+// Place a model part in the world. The entity is bobbed up by bob, then turned about its
+// anchor (with pitch in place of its own, for a swinging part), then the part is moved to
+// position and scaled by scale, as its model says.
+inline glm::mat4 partModel(const Transform& transform, glm::vec3 position, glm::vec3 scale, float bob, float pitch)
+{
+	glm::mat4 model;
+	if (bob != 0.0f) model = glm::translate(model, glm::vec3(0.0f, bob, 0.0f));
+	model = glm::translate(model, transform.anchor);
 
-	// Getters
-	glm::vec3 getPosition() { return ePos; }
-	glm::vec3 getDirection() { return eDir; }
-	glm::vec3 getFront() { return eFront; }
-	glm::vec3 getUp() { return eUp; }
-	glm::vec3 getRight() { return eRight; }
-	float getSpeed() { return spd; }
-	glm::vec3 getScale(int idx) { return scales[idx]; }
-	glm::vec3 getAncor() { return ancor; }
-	float getYaw() { return yaw; }
-	float getPitch() { return pitch; }
-	float getRoll() { return roll; }
-	bool isAlive() { return alive; }
-
-	virtual void die() {
-		alive = false;
+	if (transform.yaw != 0) {
+		model = glm::rotate(model, glm::radians(transform.yaw), glm::vec3(0.0f, 1.0f, 0.0f));
 	}
-
-	void setPosition(glm::vec3 newPos)
-	{
-		ePos = newPos;
-		eDir = calcDirection();
-		eRight = calcRight();
+	if (pitch != 0) {
+		model = glm::rotate(model, glm::radians(pitch), glm::vec3(1.0f, 0.0f, 0.0f));
 	}
-
-	void setFront(glm::vec3 inFront)
-	{
-		eFront = inFront;
+	if (transform.roll != 0) {
+		model = glm::rotate(model, glm::radians(transform.roll), glm::vec3(0.0f, 0.0f, 1.0f));
 	}
 
-	void setUp(glm::vec3 inUp)
-	{
-		eUp = inUp;
-		eRight = calcRight();
-	}
-	
-	void setModel(glm::vec3 inScales[], glm::vec3 inPositions[], int arrSize)
-	{
-		positions = inPositions;
-		scales = inScales;
-		numModels = arrSize;
+	// If the anchor isn't where the entity is, turn about the anchor and move back
+	if (transform.anchor != transform.position) {
+		model = glm::translate(model, -transform.anchor);
+		model = glm::translate(model, transform.position);
 	}
 
-	void setTextures(unsigned int *inTextures, int numT)
-	{
-		textures = inTextures;
-		numTextures = numT;
-	}
+	model = glm::translate(model, position);
+	model = glm::scale(model, scale);
+	return model;
+}
 
-	virtual glm::mat4 doTransformations(glm::mat4 currModel, int ii)
-	{
-		bool animated = false;
-		float originalPitch = pitch;
-		try {
-			float const upperThreshold = 25.0f;
-			float const lowerThreshold = -25.0f;
-			float ptch = std::get<0>(pitchAnimation.at(ii));
-			float increment = std::get<1>(pitchAnimation.at(ii));
-			ptch += increment;
-			setPitch(ptch);
-			//std::cout << pitch << "\n";
-			if (pitch > upperThreshold || pitch < lowerThreshold) {
-				std::get<1>(pitchAnimation.at(ii)) = -increment;
-			} 
-			std::get<0>(pitchAnimation.at(ii)) = pitch;
-			animated = true;
- 
-		} catch (const std::out_of_range& oor) {
-			setPitch(originalPitch);		
-		}
-	
-		currModel = glm::translate(currModel, ancor);
+// What an entity looks like
+struct Renderable
+{
+	int model;			// into World::models
+	int lod;			// the level of detail in use
+	bool visible;
+	bool castsShadow;	// false for whatever holds the light, as the light sits inside it
+};
 
-		if (yaw != 0) {
-			currModel = glm::rotate(currModel, glm::radians(yaw), glm::vec3(0.0f, 1.0f, 0.0f));
-		}
-		if (pitch != 0) {
-			currModel = glm::rotate(currModel, glm::radians(pitch), glm::vec3(1.0f, 0.0f, 0.0f));
-			if (animated) setPitch(originalPitch);
-		}
-		if (roll != 0) {
-			currModel = glm::rotate(currModel, glm::radians(roll), glm::vec3(0.0f, 0.0f, 1.0f));
-		}
+// What an entity does by itself, as tracks (see animation.hpp): bob up and down and spin
+// (pickups), and swing some of its parts back and forth about their pitch. Its own tracks
+// are found by their place in its range, from firstTrack.
+struct Animation
+{
+	float bob;					// how far up it is, from its TRACK_BOB
+	int firstTrack, numTracks;	// into World::tracks
+	int bobTrack, yawTrack;		// its TRACK_BOB and TRACK_YAW, or -1
+	int firstPart, numParts;	// into World::partTracks, the TRACK_PITCH of each part (or -1)
+};
 
-		//If the ancor IS NOT ePos, we must first convert it back
-		if (ancor.x != ePos.x || ancor.y != ePos.y || ancor.z != ePos.z) { 
-			currModel = glm::translate(currModel, -ancor);
-			currModel = glm::translate(currModel, ePos);
-		}
+// Going after another entity, and knocking it down once within reach
+struct Chase
+{
+	EntityId target;
+	float speed;	// units a second
+	float reach;
+};
 
-		currModel = glm::translate(currModel, positions[ii]);
-		currModel = glm::scale(currModel, scales[ii]);
+// What picking an entity up does
+enum PickupKind
+{
+	PICKUP_LIGHT,	// the player carries the light from then on
+	PICKUP_GOAL		// one of the items that open the door
+};
 
-		return currModel;
-	}
+struct PickupState
+{
+	PickupKind kind;
+};
 
-	virtual void render(unsigned int VAO_box, Shader shader)
-	{
-		if (visible) {
-			glBindVertexArray(VAO_box);
-
-			unsigned int glTex[] = {GL_TEXTURE0, GL_TEXTURE1};
-		
-			for (int ii = 0; ii < numTextures; ii++)
-			{
-				glActiveTexture(glTex[ii]);
-				glBindTexture(GL_TEXTURE_2D, textures[ii]);
-			}
-
-			// Construct the model(s)
-			glm::mat4 currModel;
-			for (int ii = 0; ii < numModels; ii++)
-			{
-				currModel = glm::mat4();
-				currModel = doTransformations(currModel, ii);
-			
-				shader.setMat4("model", currModel);
-				glDrawArrays(GL_TRIANGLES, 0, 36);
-			}
-		}
-	}
+// Every entity in the level, as rows of component arrays. Rows are packed: destroying an
+// entity moves the last row into its place, so systems walk each array from start to end
+// (checking masks for the components they need) without chasing pointers. Ids stay valid
+// until clear(); rows don't, so keep ids.
+class World
+{
 
-	void move(glm::vec3 offset)
-	{
-		ePos += offset;
-		ancor += offset;
-	}
+private:
 
-	void setYaw(float a) { yaw = a; }
-	void setPitch(float p) { pitch = p; }
-	void setRoll(float r) { roll = r; }
+	// Fields
+	std::vector<int> rows;			// by id, -1 once destroyed
+	unsigned int sceneryRevision;	// bumped whenever anything static changes
+	double time;					// seconds simulated since clear(), the tracks' clock
 
-	void changeYawBy(float yaw_offset)
+	template <typename T>
+	static void removeRow(std::vector<T>& column, int row)
 	{
-		yaw += yaw_offset;
-		while (yaw > 360) yaw -= 360;
-		while (yaw < 0) yaw += 360;
+		column[row] = column.back();
+		column.pop_back();
 	}
 
-	void changePitchBy(float pitch_offset)
+	// Take a row's tracks out, moving the ranges of the ones after back. Destroying is rare
+	// (a pickup collected), so it's done then rather than skipping dead tracks every tick.
+	void removeTracks(int row)
 	{
-		pitch += pitch_offset;
-		while (pitch > 89.0f) pitch -= 89.0f;
-		while (pitch < -89.0f) pitch += 89.0f;
+		Animation& anim = animations[row];
+		int first = anim.firstTrack, count = anim.numTracks;
+		int firstPart = anim.firstPart, numParts = anim.numParts;
+		if (count == 0 && numParts == 0) return;
+		tracks.erase(tracks.begin() + first, tracks.begin() + first + count);
+		trackValues.erase(trackValues.begin() + first, trackValues.begin() + first + count);
+		partTracks.erase(partTracks.begin() + firstPart, partTracks.begin() + firstPart + numParts);
+		anim.numTracks = 0;
+		anim.numParts = 0;
+
+		for (size_t ii = 0; ii < animations.size(); ii++)
+		{
+			if (animations[ii].numTracks > 0 && animations[ii].firstTrack > first) animations[ii].firstTrack -= count;
+			if (animations[ii].numParts > 0 && animations[ii].firstPart > firstPart) animations[ii].firstPart -= numParts;
+		}
 	}
 
-	void setAncor(glm::vec3 a)
+public:
+
+	// Components, a row per entity
+	std::vector<EntityId> ids;
+	std::vector<unsigned int> masks;			// ComponentBits
+	std::vector<unsigned char> alive;
+	std::vector<Transform> transforms;
+	std::vector<Renderable> renderables;
+	std::vector<Animation> animations;
+	std::vector<Chase> chases;
+	std::vector<PickupState> pickups;
+
+	// Shared between rows
+	std::vector<Model> models;
+	std::vector<AnimationTrack> tracks;
+	std::vector<float> trackValues;		// each track's value as of the last tick
+	std::vector<int> partTracks;		// see Animation
+	std::vector<AnimationCurve> curves;
+	std::vector<Keyframe> keyframes;
+
+	// Constructor
+	World()
 	{
-		ancor = a;
+		sceneryRevision = 0;
+		time = 0.0;
 	}
 
-	void setSpeed(float newSpeed)
+	// Remove every entity and model. Ids start from 0 again.
+	void clear()
 	{
-		spd = newSpeed;
+		if (!rows.empty()) sceneryRevision++;
+		rows.clear();
+		ids.clear();
+		masks.clear();
+		alive.clear();
+		transforms.clear();
+		renderables.clear();
+		animations.clear();
+		chases.clear();
+		pickups.clear();
+		models.clear();
+		tracks.clear();
+		trackValues.clear();
+		partTracks.clear();
+		curves.clear();
+		keyframes.clear();
+		time = 0.0;
 	}
 
-	void setVisible(bool b) 
+	// A new entity at position with the given components, all at their defaults
+	EntityId create(unsigned int mask, glm::vec3 position)
 	{
-		visible = b;	
+		EntityId id = (EntityId)rows.size();
+		rows.push_back((int)ids.size());
+		ids.push_back(id);
+		masks.push_back(mask | HAS_TRANSFORM);
+		alive.push_back(1);
+
+		Transform transform = { position, position, 0.0f, PITCH_DEFAULT, 0.0f };
+		Renderable renderable = { -1, 0, true, true };
+		Animation animation = { 0.0f, 0, 0, -1, -1, 0, 0 };
+		Chase chase = { NO_ENTITY, 0.0f, 0.0f };
+		PickupState pickup = { PICKUP_GOAL };
+		transforms.push_back(transform);
+		renderables.push_back(renderable);
+		animations.push_back(animation);
+		chases.push_back(chase);
+		pickups.push_back(pickup);
+
+		if (mask & IS_STATIC) sceneryRevision++;
+		return id;
 	}
 
-	void setPitchAnimation(int idx, float inc)
+	void destroy(EntityId id)
 	{
-		pitchAnimation.insert(std::pair<int, std::tuple<float, float>>(
-			idx, std::tuple<float, float>{pitch, inc})
-		);
+		int row = rows[id];
+		if (row < 0) return;
+		if (masks[row] & IS_STATIC) sceneryRevision++;
+		removeTracks(row);
+
+		rows[ids.back()] = row;
+		rows[id] = -1;
+		removeRow(ids, row);
+		removeRow(masks, row);
+		removeRow(alive, row);
+		removeRow(transforms, row);
+		removeRow(renderables, row);
+		removeRow(animations, row);
+		removeRow(chases, row);
+		removeRow(pickups, row);
 	}
-};
 
-// Description of the player camera
-class Camera : public Entity
-{
+	bool exists(EntityId id) { return id < rows.size() && rows[id] >= 0; }
+	bool has(EntityId id, unsigned int bits) { return (masks[rows[id]] & bits) == bits; }
+	int getCount() { return (int)ids.size(); }
+	int row(EntityId id) { return rows[id]; }
 
-private:
-	
-	// Fields
-	float lastX, lastY, sensitivity; // old x & y positions of mouse
-	bool firstMouse, itemVisible;
-	Entity* item;
+	// An entity's components, by id
+	Transform& transform(EntityId id) { return transforms[rows[id]]; }
+	Renderable& renderable(EntityId id) { return renderables[rows[id]]; }
+	Animation& animation(EntityId id) { return animations[rows[id]]; }
+	Chase& chase(EntityId id) { return chases[rows[id]]; }
+	PickupState& pickup(EntityId id) { return pickups[rows[id]]; }
 
-public:	
-	
-	// Constructor
-	Camera(glm::vec3 camPos, glm::vec3 camFront, glm::vec3 camUp, int scrWidth, int scrHeight) 
-	: Entity(camPos, camFront, camUp)  
-	{
-		yaw = YAW_DEFAULT;	
-		sensitivity = SENSITIVITY_DEFAULT;
-		lastX = scrWidth / 2.0f; 
-		lastY = scrHeight / 2.0f;
-		firstMouse = true;
-		itemVisible = false;
-		item = NULL;
-	}
+	bool isAlive(EntityId id) { return alive[rows[id]] != 0; }
+	void kill(EntityId id) { alive[rows[id]] = 0; }
 
-	void setItem(Entity* inE)
+	// Add a model and return its number, for setModel()
+	int addModel(glm::vec3 scales[], glm::vec3 positions[], int numModels,
+		unsigned int *textures, int numTextures)
 	{
-		// object should float in-front of the camera view
-		glm::vec3 offset = glm::vec3(0.1f, -0.1, -0.3f);
-		item = inE;
-		item->setPosition(ePos);
-		item->move(offset);
-		item->setAncor(ePos);
+		Model model;
+		model.lods.push_back(ModelLod{scales, positions, numModels, 0.0f});
+		model.textures = textures;
+		model.numTextures = numTextures;
+		models.push_back(model);
+		return (int)models.size() - 1;
 	}
 
-	void setItemVisible(bool b)
+	// Use a coarser version of a model from distance on (e.g. one box where the parts blur
+	// together). Its part ii animates like part ii of the full model.
+	void addLod(int model, glm::vec3 scales[], glm::vec3 positions[], int numModels, float distance)
 	{
-		itemVisible = b;
-	}
-	
-	void mouseMoved(double xpos, double ypos) 
-	{
-		if (alive)
-		{
-			if (firstMouse) 
-			{
-				lastX = xpos;
-				lastY = ypos;
-				firstMouse = false;
-			}
-
-			// Update coords
-			float xoffset = xpos - lastX;
-			float yoffset = lastY - ypos;
-			lastX = xpos;
-			lastY = ypos;
-
-			// Apply sensitivity
-			xoffset *= sensitivity;
-			yoffset *= sensitivity;
-
-			// Modify cam angle
-			yaw += xoffset;
-			pitch += yoffset;
-
-			// Update item angle
-			if (item != NULL)
-			{
-				item->changeYawBy(-xoffset);
-				if ((item->getPitch()+yoffset) < 89.0f && (item->getPitch()+yoffset) > -89.0f) {
-					item->changePitchBy(yoffset);
-				}
-			}
-
-			// Constraints -- ensure we don't flip the direction vector
-			if (pitch > 89.0f)
-			{
-				pitch = 89.0f;
-			}
-			else if (pitch < -89.0f)
-			{
-				pitch = -89.0f;
-			}
-			while (yaw > 360) yaw -= 360;
-			while (yaw < 0) yaw += 360;
-
-			// Update vectors
-			glm::vec3 direction;
-			direction.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
-			direction.y = sin(glm::radians(pitch));
-			direction.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
-			eFront = glm::normalize(direction); 
-			eRight = glm::normalize(glm::cross(eFront, eUp));
-		}
+		std::vector<ModelLod>& lods = models[model].lods;
+		std::vector<ModelLod>::iterator it = lods.begin() + 1;
+		while (it != lods.end() && it->distance < distance) ++it;
+		lods.insert(it, ModelLod{scales, positions, numModels, distance});
 	}
 
-	void move(glm::vec3 offset)
+	void setModel(EntityId id, int model)
 	{
-		Entity::move(offset);
-		if (item != NULL) {
-			item->move(offset);
-		} 
+		masks[rows[id]] |= HAS_MODEL;
+		renderable(id).model = model;
+		renderable(id).lod = 0;
+		if (masks[rows[id]] & IS_STATIC) sceneryRevision++;
 	}
 
-	void render(unsigned int VAO_box, Shader lighting_shader)
+	void setVisible(EntityId id, bool visible)
 	{
-		if (item != NULL && itemVisible)
-		{
-			item->render(VAO_box, lighting_shader);
-		}
+		renderable(id).visible = visible;
+		if (masks[rows[id]] & IS_STATIC) sceneryRevision++;
 	}
 
-	void die() 
+	// Add a curve for tracks to share, and return its number, for addTrack()
+	int addCurve(AnimationCurve curve)
 	{
-		Entity::die();
-		ePos = glm::vec3(ePos.x, 0.1, ePos.z);
+		curves.push_back(curve);
+		return (int)curves.size() - 1;
 	}
-};
-
-class Pickup : public Entity
-{
-
-private:
 
-	// Fields
-	float translation;
-	bool rotate;
-
-public:
-
-	// Constructor
-	Pickup(glm::vec3 pPos, glm::vec3 pFront, glm::vec3 pUp) 
-	: Entity(pPos, pFront, pUp)
-	{
-		translation = 0.0f;
-		rotate = true;
-	}
-		
-	void setRotateAnimation(bool b)
+	// Add a curve through keys (the first at time 0), looping after the last
+	int addKeyframeCurve(const Keyframe keys[], int numKeys)
 	{
-		rotate = b;
-	}
-		
-	glm::mat4 doTransformations(glm::mat4 currModel, int ii)
-	{
-		// Up down "bobbing" animation
-		currModel = glm::translate(
-			currModel, 
-			glm::vec3(0.0f, (0.1f * sin(translation * PI / 180.f)), 0.0f)
-		);
-
-		currModel = Entity::doTransformations(currModel, ii);
-
-		return currModel;
+		float length = keys[numKeys - 1].time;
+		AnimationCurve curve = { TRACK_KEYFRAMES, 0.0f, 0.0f, 0.0f,
+			(int)keyframes.size(), numKeys, length, length > 0.0f ? 1.0 / length : 0.0, -1.0, 0.0f };
+		keyframes.insert(keyframes.end(), keys, keys + numKeys);
+		for (int ii = curve.firstKey; ii < curve.firstKey + numKeys - 1; ii++)
+		{
+			float span = keyframes[ii + 1].time - keyframes[ii].time;
+			keyframes[ii].slope = span > 0.0f ? (keyframes[ii + 1].value - keyframes[ii].value) / span : 0.0f;
+		}
+		keyframes.back().slope = 0.0f;
+		return addCurve(curve);
 	}
 
-	void render(unsigned int VAO_box, Shader lighting_shader)
+	// Drive channel of an entity (of part, for TRACK_PITCH) along curve from base, starting
+	// now. An entity's tracks must all be added before the next entity's.
+	void addTrack(EntityId id, TrackChannel channel, int part, int curve, float base)
 	{
-		translation += ANIMATION_SPEED;
-		if(abs(translation - 360.0f) <= 0.1f) translation = 0.0f;
-
-		if (rotate) {	
-			changeYawBy(ANIMATION_SPEED);
+		masks[rows[id]] |= HAS_ANIMATION;
+		Animation& anim = animation(id);
+		if (anim.numTracks == 0) anim.firstTrack = (int)tracks.size();
+		int track = anim.numTracks++;
+		if (channel == TRACK_BOB) anim.bobTrack = track;
+		if (channel == TRACK_YAW) anim.yawTrack = track;
+		if (channel == TRACK_PITCH)
+		{
+			if (anim.numParts == 0) anim.firstPart = (int)partTracks.size();
+			for (; anim.numParts <= part; anim.numParts++) partTracks.push_back(-1);
+			partTracks[anim.firstPart + part] = track;
 		}
 
-		Entity::render(VAO_box, lighting_shader);
+		AnimationTrack added = { time, curve, base };
+		tracks.push_back(added);
+		trackValues.push_back(evaluateTrack(added, curves[curve], keyframes, time));
 	}
-};
-
-class Enemy : public Entity
-{
 
-private:
+	// Move the tracks' clock on by dt seconds
+	void advance(float dt) { time += dt; }
+	double getTime() { return time; }
 
-	// Fields
-	Entity* target;
-
-public:
-
-	// Constructor
-	Enemy(glm::vec3 pPos, glm::vec3 pFront, glm::vec3 pUp, Entity* inTarget) 
-	: Entity(pPos, pFront, pUp)
-	{
-		target = inTarget;
-	}
-
-	void render(unsigned int VAO_box, Shader lighting_shader)
-	{
-		Entity::render(VAO_box, lighting_shader);
-		//set angle
-		
-		// Move towards target
-		float threshold = 1.0f;
-		if (glm::length(ePos - target->getPosition()) > threshold && target->isAlive())
-		{
-			glm::vec3 dir = target->getPosition() - ePos;
-			
-			setYaw(glm::degrees(atan2(dir.x, dir.z)));
-
-			eFront = glm::normalize(dir); 
-			eRight = glm::normalize(glm::cross(eFront, eUp));
-
-			move(eFront * spd);
-		}
-		else
-		{
-			target->die();
-		}
-	}
+	unsigned int getSceneryRevision() { return sceneryRevision; }
 };
+
+#endif
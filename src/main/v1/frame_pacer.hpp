@@ -0,0 +1,185 @@
+#ifndef FRAME_PACER_HPP
+#define FRAME_PACER_HPP
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "clock.hpp"
+#include "profiler.hpp"
+
+// How buffer swaps line up with the display
+enum SwapMode
+{
+	SWAP_IMMEDIATE,	// swap at once, tearing if need be
+	SWAP_VSYNC,		// wait for the vertical blank
+	SWAP_ADAPTIVE	// wait for it, unless the frame already missed it (where supported)
+};
+
+static const int PACER_HISTORY = 240;			// frames of timings kept
+static const double PACER_MIN_SPIN = 0.0005;	// seconds short of a deadline a sleep always stops
+static const double PACER_SPIN_DECAY = 0.99;	// how fast a past late wake-up is forgotten
+
+// Where one frame's time went, in seconds
+struct FrameTiming
+{
+	double cpu;		// from the end of the last present to the start of this one
+	double wait;	// held back to keep to the target rate
+	double present;	// inside glfwSwapBuffers (glFinish offscreen)
+};
+
+// Keeps frames to a target rate and records where their time goes. Waiting for a deadline
+// sleeps for most of the time and spins on the clock for the rest, as a sleep can wake up
+// late by about a scheduler tick; how late sleeps have woken recently sets how much is spun.
+class FramePacer
+{
+
+private:
+
+	// Fields
+	SwapMode mode;
+	double interval;		// seconds per frame at the target rate, 0 for no limit
+	double deadline;		// when the next frame may be presented
+	double frameStart;		// when the last present finished
+	double spinMargin;		// seconds before a deadline to stop sleeping
+	FrameTiming history[PACER_HISTORY];
+	int next, count;
+
+	// Hold on until the given time
+	void waitUntil(double until)
+	{
+		double sleepFor = until - clockSeconds() - spinMargin;
+		if (sleepFor > 0.0)
+		{
+			double asleep = clockSeconds();
+			std::this_thread::sleep_for(std::chrono::duration<double>(sleepFor));
+			double late = clockSeconds() - asleep - sleepFor;
+			spinMargin = std::max(std::max(late, spinMargin * PACER_SPIN_DECAY), PACER_MIN_SPIN);
+		}
+		while (clockSeconds() < until)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+public:
+
+	// Constructor -- no rate limit until one is set
+	FramePacer()
+	{
+		mode = SWAP_VSYNC;
+		interval = 0.0;
+		deadline = 0.0;
+		frameStart = clockSeconds();
+		spinMargin = 0.002;
+		next = 0;
+		count = 0;
+	}
+
+	// Swap as mode says, for the current context. Adaptive needs the swap control tear
+	// extension and falls back to vsync without it; returns the mode actually in use.
+	SwapMode setMode(SwapMode inMode)
+	{
+		mode = inMode;
+		if (mode == SWAP_ADAPTIVE && !glfwExtensionSupported("WGL_EXT_swap_control_tear")
+			&& !glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+		{
+			mode = SWAP_VSYNC;
+		}
+		glfwSwapInterval(mode == SWAP_IMMEDIATE ? 0 : mode == SWAP_VSYNC ? 1 : -1);
+		return mode;
+	}
+
+	// Present at most fps frames a second, or as fast as the swap mode lets through for 0
+	void setTargetRate(double fps)
+	{
+		interval = fps > 0.0 ? 1.0 / fps : 0.0;
+		deadline = clockSeconds();
+	}
+
+	SwapMode getMode() { return mode; }
+	double getTargetRate() { return interval > 0.0 ? 1.0 / interval : 0.0; }
+
+	// Wait for this frame's deadline, then swap. With no window (rendering offscreen) there's
+	// nothing to swap, so it waits for the GPU to finish instead.
+	void present(GLFWwindow* window)
+	{
+		FrameTiming timing;
+		double now = clockSeconds();
+		timing.cpu = now - frameStart;
+		timing.wait = 0.0;
+		if (interval > 0.0)
+		{
+			deadline += interval;
+			if (deadline < now)
+			{
+				// Fell behind: start again from now rather than rushing to catch up
+				deadline = now;
+			}
+			else
+			{
+				waitUntil(deadline);
+				timing.wait = clockSeconds() - now;
+			}
+		}
+
+		double swapStart = clockSeconds();
+		if (window != NULL)
+		{
+			PROFILE_ZONE("glfwSwapBuffers");
+			glfwSwapBuffers(window);
+		}
+		else
+		{
+			PROFILE_ZONE("glFinish");
+			glFinish();
+		}
+		frameStart = clockSeconds();
+		timing.present = frameStart - swapStart;
+
+		history[next] = timing;
+		next = (next + 1) % PACER_HISTORY;
+		if (count < PACER_HISTORY) count++;
+	}
+
+	// Frames recorded, up to PACER_HISTORY
+	int getCount() { return count; }
+
+	// Timings of a recent frame: 0 is the last one, then further back
+	const FrameTiming& getTiming(int ago)
+	{
+		return history[(next - 1 - ago + 2 * PACER_HISTORY) % PACER_HISTORY];
+	}
+
+	// Mean timings over the last frames (up to PACER_HISTORY of them)
+	FrameTiming getAverage(int frames)
+	{
+		FrameTiming sum = {0.0, 0.0, 0.0};
+		frames = std::min(frames, count);
+		for (int ii = 0; ii < frames; ii++)
+		{
+			const FrameTiming& timing = getTiming(ii);
+			sum.cpu += timing.cpu;
+			sum.wait += timing.wait;
+			sum.present += timing.present;
+		}
+		if (frames > 0)
+		{
+			sum.cpu /= frames;
+			sum.wait /= frames;
+			sum.present /= frames;
+		}
+		return sum;
+	}
+};
+
+// Name of a swap mode, as given on the command line
+inline const char* swapModeName(SwapMode mode)
+{
+	return mode == SWAP_IMMEDIATE ? "immediate" : mode == SWAP_VSYNC ? "vsync" : "adaptive";
+}
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef FRAME_STATS_HPP
+#define FRAME_STATS_HPP
+
+#include <iostream>
+
+// Per-frame rendering counters, reset at the start of every frame
+struct FrameStats
+{
+	int drawItems;		// items submitted to the render queue
+	int drawCalls;		// glDraw* calls actually issued
+	int bindsIssued;	// program, VAO and texture binds issued
+	int bindsAvoided;	// binds an unsorted submission would have issued on top of those
+	int uniformUploads;	// glUniform* calls issued
+	int uniformSkips;	// uniform sets dropped because the value was already there
+	int glCallsIssued;	// binds and state changes that reached GL through the state cache
+	int glCallsElided;	// ones the state cache dropped as redundant
+	int entitiesCulled;	// entities skipped because their bounds were outside the view frustum
+	int partsCulled;	// model parts skipped inside entities that were only partly visible
+	int unlitCulled;	// entities and static segments entirely beyond the light's reach
+	int lodPartsSaved;	// model parts left out by drawing entities at a coarser level of detail
+	int cellsVisible;	// level cells reached through open portals from the camera's cell
+	int cellsTotal;
+	int fragmentsShaded;	// samples that passed the depth test in the shading pass (last frame's)
+	int pixels;				// size of the viewport, to turn that into overdraw
+	int pointLights;		// point lights sorted into clusters
+	int lightReferences;	// entries in the per-cluster light lists
+	double clusterTime;		// seconds spent building those lists on the CPU
+	bool deferred;			// whether the scene was shaded deferred rather than forward
+	double frameTime;		// seconds since the previous frame
+	double sceneGpuTime;	// milliseconds the GPU spent drawing the scene (a frame behind)
+	double lightingGpuTime;	// and lighting the G-buffer, when deferred
+	double shadowGpuTime;	// and drawing the light's shadows, when it casts any
+	int shadowStaticRedraws;	// times the cached static shadows have been drawn so far
+	const char* swapMode;	// how buffer swaps meet the display (see frame_pacer.hpp)
+	double targetRate;		// frames a second the pacer holds to, 0 for no limit
+	double cpuTime;			// recent average seconds a frame spent working,
+	double waitTime;		// held back for the target rate,
+	double presentTime;		// and swapping buffers
+
+	FrameStats()
+	{
+		reset();
+	}
+
+	void reset()
+	{
+		drawItems = 0;
+		drawCalls = 0;
+		bindsIssued = 0;
+		bindsAvoided = 0;
+		uniformUploads = 0;
+		uniformSkips = 0;
+		glCallsIssued = 0;
+		glCallsElided = 0;
+		entitiesCulled = 0;
+		partsCulled = 0;
+		unlitCulled = 0;
+		lodPartsSaved = 0;
+		cellsVisible = 0;
+		cellsTotal = 0;
+		fragmentsShaded = 0;
+		pixels = 0;
+		pointLights = 0;
+		lightReferences = 0;
+		clusterTime = 0.0;
+		deferred = false;
+		frameTime = 0.0;
+		sceneGpuTime = 0.0;
+		lightingGpuTime = 0.0;
+		shadowGpuTime = 0.0;
+		shadowStaticRedraws = 0;
+		swapMode = "";
+		targetRate = 0.0;
+		cpuTime = 0.0;
+		waitTime = 0.0;
+		presentTime = 0.0;
+	}
+
+	void print(std::ostream& out) const
+	{
+		out << "items " << drawItems
+			<< " | draws " << drawCalls
+			<< " | binds " << bindsIssued << " issued, " << bindsAvoided << " avoided"
+			<< " | uniforms " << uniformUploads << " uploaded, " << uniformSkips << " skipped"
+			<< " | gl state " << glCallsIssued << " issued, " << glCallsElided << " elided"
+			<< " | culled " << entitiesCulled << " entities, " << partsCulled << " parts, "
+				<< unlitCulled << " unlit"
+			<< " | lod saved " << lodPartsSaved << " parts"
+			<< " | cells " << cellsVisible << " of " << cellsTotal << " visible"
+			<< " | static shadows drawn " << shadowStaticRedraws << " times";
+		if (pointLights > 0)
+		{
+			out << " | " << pointLights << " point lights in " << lightReferences
+				<< " cluster slots, built in " << clusterTime * 1e3 << " ms";
+		}
+		if (pixels > 0)
+		{
+			out << " | shaded " << fragmentsShaded << " fragments, "
+				<< (float)fragmentsShaded / pixels << " per pixel";
+		}
+		out << " | " << (deferred ? "deferred" : "forward") << ", frame " << frameTime * 1e3
+			<< " ms, GPU " << sceneGpuTime << " ms";
+		if (deferred)
+		{
+			out << " geometry + " << lightingGpuTime << " ms lighting";
+		}
+		if (shadowGpuTime > 0.0) out << " + " << shadowGpuTime << " ms shadows";
+		out << " | " << swapMode;
+		if (targetRate > 0.0) out << " at " << targetRate << " fps";
+		out << ", cpu " << cpuTime * 1e3 << " ms, wait " << waitTime * 1e3 << " ms, present "
+			<< presentTime * 1e3 << " ms";
+		out << std::endl;
+	}
+};
+
+#endif
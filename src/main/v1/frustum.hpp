@@ -0,0 +1,120 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <glm/glm.hpp>
+
+#include <float.h>
+#include <math.h>
+
+// Axis-aligned bounding box in world space
+struct AABB
+{
+	glm::vec3 min, max;
+
+	// Constructor -- an empty box, which extend() grows from nothing
+	AABB()
+	{
+		min = glm::vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+		max = glm::vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	}
+
+	AABB(glm::vec3 inMin, glm::vec3 inMax)
+	{
+		min = inMin;
+		max = inMax;
+	}
+
+	bool isEmpty() const { return min.x > max.x; }
+	glm::vec3 center() const { return (min + max) * 0.5f; }
+	glm::vec3 extents() const { return (max - min) * 0.5f; }
+
+	void extend(const AABB& other)
+	{
+		min = glm::min(min, other.min);
+		max = glm::max(max, other.max);
+	}
+
+	bool intersects(const AABB& other) const
+	{
+		return min.x <= other.max.x && max.x >= other.min.x
+			&& min.y <= other.max.y && max.y >= other.min.y
+			&& min.z <= other.max.z && max.z >= other.min.z;
+	}
+
+	// Squared distance from a point to the nearest point of the box (0 inside it)
+	float distanceSquared(glm::vec3 point) const
+	{
+		glm::vec3 nearest = glm::clamp(point, min, max);
+		glm::vec3 offset = point - nearest;
+		return glm::dot(offset, offset);
+	}
+
+	// World box around the unit cube (the box mesh) placed by a model matrix. The half
+	// extents are the absolute values of the basis vectors, halved.
+	static AABB ofUnitBox(const glm::mat4& model)
+	{
+		glm::vec3 center = glm::vec3(model[3]);
+		glm::vec3 half = 0.5f * (glm::abs(glm::vec3(model[0]))
+			+ glm::abs(glm::vec3(model[1])) + glm::abs(glm::vec3(model[2])));
+		return AABB(center - half, center + half);
+	}
+};
+
+enum Visibility { OUTSIDE, INTERSECTS, INSIDE };
+
+// The six clip planes of a projection * view matrix, pointing inwards
+struct Frustum
+{
+	glm::vec4 planes[6];
+
+	Frustum()
+	{
+		for (int ii = 0; ii < 6; ii++)
+		{
+			planes[ii] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f); // accepts everything
+		}
+	}
+
+	// Gribb-Hartmann: each plane is the fourth row of the matrix plus or minus another row
+	void extract(const glm::mat4& viewProjection)
+	{
+		glm::vec4 rows[4];
+		for (int ii = 0; ii < 4; ii++)
+		{
+			rows[ii] = glm::vec4(
+				viewProjection[0][ii], viewProjection[1][ii], viewProjection[2][ii], viewProjection[3][ii]
+			);
+		}
+		planes[0] = rows[3] + rows[0]; // left
+		planes[1] = rows[3] - rows[0]; // right
+		planes[2] = rows[3] + rows[1]; // bottom
+		planes[3] = rows[3] - rows[1]; // top
+		planes[4] = rows[3] + rows[2]; // near
+		planes[5] = rows[3] - rows[2]; // far
+
+		for (int ii = 0; ii < 6; ii++)
+		{
+			planes[ii] /= glm::length(glm::vec3(planes[ii]));
+		}
+	}
+
+	Visibility classify(const AABB& box) const
+	{
+		glm::vec3 center = box.center();
+		glm::vec3 half = box.extents();
+		Visibility result = INSIDE;
+
+		for (int ii = 0; ii < 6; ii++)
+		{
+			glm::vec3 normal = glm::vec3(planes[ii]);
+			float distance = glm::dot(normal, center) + planes[ii].w;
+			float radius = glm::dot(glm::abs(normal), half); // box's reach along the normal
+
+			if (distance < -radius) return OUTSIDE;
+			if (distance < radius) result = INTERSECTS;
+		}
+		return result;
+	}
+};
+
+#endif
@@ -9,10 +9,41 @@
 #include <learnopengl/filesystem.h>
 #include <learnopengl/shader_m.h>
 
+#include <atomic>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
-
+#include <thread>
+#include <ctype.h>
+#include <stdlib.h>
+
+#include "benchmark.hpp"
+#include "camera.hpp"
+#include "camera_script.hpp"
+#include "cells.hpp"
+#include "clusters.hpp"
+#include "deferred.hpp"
+#include "ecs_bench.hpp"
 #include "entity.hpp"
+#include "frame_pacer.hpp"
+#include "frame_stats.hpp"
+#include "gl_state.hpp"
+#include "gpu_timer.hpp"
+#include "headless.hpp"
+#include "light_bench.hpp"
+#include "light_range.hpp"
+#include "primitive_mesh.hpp"
+#include "profiler.hpp"
+#include "render_queue.hpp"
+#include "shadow_map.hpp"
+#include "snapshot.hpp"
+#include "static_batch.hpp"
+#include "systems.hpp"
+#include "triple_buffer.hpp"
+#include "uniform_blocks.hpp"
+#include "vertex_bench.hpp"
 
 // Constants
 const char* GAME_TITLE = "Escape Game";
@@ -20,6 +51,9 @@ const char* GAME_TITLE = "Escape Game";
 // Screen
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 800;
+static const float NEAR_PLANE = 0.1f; // perspective near plane
+static const float VIEW_DISTANCE = 300.0f; // perspective far plane
+static const float MIN_LOD_SCALE = 0.25f; // levels of detail switch no nearer than at a quarter of SCR_HEIGHT
 glm::mat4 perspective;
 glm::mat4 orthographic;
 
@@ -32,9 +66,23 @@ static const glm::vec3 NORTH = glm::vec3(0.0f, 0.0f, -1.0f);
 static const glm::vec3 ORIGIN = glm::vec3(0.0f, 0.0f, 0.0f);
 static const float INTERACT_DISTANCE = 1.6f;
 static float lightSourceRadius = 0.5f;
+static const double DEFAULT_TICK_RATE = 60.0;	// simulation ticks a second, unless --tick-rate says
+static const int MAX_TICKS_BEHIND = 8;			// ticks the simulation catches up on before giving up time
+static const int DEFAULT_HEADLESS_FRAMES = 300;	// frames a headless run draws, unless --frames says
+static const char* BENCH_PATH = "resources/paths/flythrough.txt";	// what --bench flies along
+static const char* DEFAULT_TRACE_PATH = "trace.json";	// where T writes a capture, unless --trace says
+double tick_rate = DEFAULT_TICK_RATE;
+CameraScript camera_script;						// followed by scripted runs, if given
+std::string trace_path = DEFAULT_TRACE_PATH;
 Shader* light;
-std::list<Entity*> entities;
-std::list<Pickup*> pickups;
+World world;							// every entity in the level (see entity.hpp)
+StaticBatch* static_batch;
+SceneryParts scenery_parts;				// the static entities' parts in world space, as of scenery_revision
+unsigned int scenery_revision = 0;
+unsigned int restart_count = 0;			// times start() has run
+FramePacer* frame_pacer;
+CellGraph cell_graph;
+int door_portal;
 
 // Textures
 unsigned int* wood_textures;
@@ -125,6 +173,33 @@ glm::vec3 door_positions[] = {
 	glm::vec3(0.0f, 0.0f, -(WORLD_WIDTH/2.5))
 };
 
+// Cells -- the areas the level is split into for visibility. The inner walls and the door
+// separate the enclosure at the north end from the rest; the doorway is the portal between.
+glm::vec3 cell_mins[] = {
+	glm::vec3(-(WORLD_WIDTH/2), -5.0f, -(WORLD_LENGTH/2.5)),	//Outside
+	glm::vec3(-(WORLD_WIDTH/2), -5.0f, -(WORLD_LENGTH/2))		//Enclosure
+};
+glm::vec3 cell_maxs[] = {
+	glm::vec3( (WORLD_WIDTH/2),  5.0f,  (WORLD_LENGTH/2)),	//Outside
+	glm::vec3( (WORLD_WIDTH/2),  5.0f, -(WORLD_LENGTH/2.5))	//Enclosure
+};
+
+// Street
+glm::vec3 street_scales[] = {
+	glm::vec3(10.0f, 0.001f, WORLD_LENGTH)
+};
+glm::vec3 street_positions[] = {
+	glm::vec3(0.0f, 0.0f, 0.0f)
+};
+
+// Grass
+glm::vec3 grass_scales[] = {
+	glm::vec3(WORLD_WIDTH, 0.001f, WORLD_LENGTH)
+};
+glm::vec3 grass_positions[] = {
+	glm::vec3(0.0f, -0.01f, 0.0f)
+};
+
 // Table
 glm::vec3 table_scales[] = {
 	glm::vec3( 1.0f,  0.1f,  1.0f),		//top
@@ -178,6 +253,15 @@ glm::vec3 lantern_positions[] {
 	glm::vec3(0.0f, -0.04f, 0.0f)  // Base
 };
 
+// Lantern, from a distance -- one box around all of it
+static const float LANTERN_LOD_DISTANCE = 10.0f;
+glm::vec3 lantern_far_scales[] {
+	glm::vec3(0.07f, 0.105f, 0.06f)
+};
+glm::vec3 lantern_far_positions[] {
+	glm::vec3(0.0f, 0.01f, 0.0f)
+};
+
 // Enemy
 glm::vec3 enemy_scales[] {
 	glm::vec3(0.2f, 0.5f, 0.2f), // Torso
@@ -198,117 +282,246 @@ glm::vec3 enemy_positions[] {
 	glm::vec3(-0.05f, -0.4f - yoff, 0.0f)  // Left Leg
 };
 
-// Entities
-Entity *walls, *door, *player, *table, *tEquip; //Equiped version of the torch
-Camera *cam;
-Pickup *torch;
-Entity* light_source; // define what entity is "producing" the light
-Enemy* enemy;
+// Enemy, from a distance -- one box around all of it
+static const float ENEMY_LOD_DISTANCE = 20.0f;
+glm::vec3 enemy_far_scales[] {
+	glm::vec3(0.35f, 1.1f, 0.2f)
+};
+glm::vec3 enemy_far_positions[] {
+	glm::vec3(0.0f, -0.1f - yoff, 0.0f)
+};
 
-Pickup *goal01, *goal02, *goal03, *goal04;
+// Entities
+Camera camera;
+EntityId door, torch, tEquip; //Equiped version of the torch
+EntityId light_source; // define what entity is "producing" the light
+EntityId pickup_in_reach = NO_ENTITY; // what interacting picks up
+int bob_curve, spin_curve; // how every pickup moves (see animation.hpp)
+
+// Simulation thread -- see snapshot.hpp. The entities above belong to it once it's running.
+TripleBuffer<InputSnapshot> input_buffer;
+TripleBuffer<FrameSnapshot> snapshot_buffer;
+InputSnapshot input_state;			// being gathered on the main thread
+std::atomic<bool> simulating(false);
 
 // Prototype Declarations
 void mouse_callback(GLFWwindow* window, double xpos, double ypos); 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void process_input(GLFWwindow *window);
+void simulate(const InputSnapshot& input, float dt);
+void take_snapshot(FrameSnapshot& frame, const InputSnapshot& input, double time);
+void simulation_loop();
+void step_scripted(int frame);
+bool toggle_option(char key);
+std::string bench_options(bool headless);
+void toggle_trace();
+void framebuffer_size(GLFWwindow* window, int& width, int& height);
 unsigned int loadTexture(char const * path);
 bool collisionAt(glm::vec3 position);
-void addEntity(
-	Entity* e, 
-	glm::vec3 scales[], glm::vec3 positions[], int numModel,
-	unsigned int textures[], int numTextures);
-void addPickup(
-	Pickup* p, 
-	glm::vec3 scales[], glm::vec3 positions[], int numModel,
-	unsigned int textures[], int numTextures);
-bool is_close_to(glm::vec3 entity_pos);
+EntityId addEntity(glm::vec3 position, int model, unsigned int components);
+EntityId addPickup(glm::vec3 position, int model, PickupKind kind);
+EntityId addStatic(glm::vec3 position, int model);
+LightBlock glowLight(glm::vec3 position);
 void start();
  
 // timing
-float delta_time = 0.0f;	// time between current frame and last frame
-float last_frame = 0.0f;
+float delta_time = 0.0f;	// time between current frame and last frame (rendered, not simulated)
+double last_frame = 0.0;
 
 // Toggle (animation or states)
 bool PERSPECTIVE_PROJECTION = true;
-bool PROJECTION_UPDATED = false;
 bool SCENERY_DARK = true;
-bool INTERACTIVITY_CLOSE_ENOUGH = false;
+bool DEFERRED_SHADING = false;
+bool INSTANCED_RENDERING = true;
+bool INDIRECT_RENDERING = true;
+bool DEPTH_PREPASS = false;
+bool FRONT_TO_BACK = false;
+bool FRUSTUM_CULLING = true;
+bool CELL_CULLING = true;
+bool LIGHT_CULLING = true;
+bool GLOWING_PICKUPS = true;
+bool SHADOWS = true;
+bool LEVELS_OF_DETAIL = true;
+bool SHOW_STATS = false;
 bool ALL_ITEMS_FOUND = false;
-int closest_pickup_idx = 0;
 int num_items_found;
 
 // Main Algorithm
 // --------------
-int main()
+int main(int argc, char** argv)
 {
-	// glfw: initialize and configure
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);	
+	// Command line options
+	bool vertex_benchmark = false;
+	bool light_benchmark = false;
+	bool ecs_benchmark = false;
+	SwapMode swap_mode = SWAP_VSYNC;
+	double target_fps = 0.0;
+	bool headless = false;
+	int headless_frames = 0; // 0 for DEFAULT_HEADLESS_FRAMES, or the whole benchmark path
+	std::string dump_path;
+	std::string bench_path;
+	std::string compare_paths[2];
+	double tolerance = BENCH_TOLERANCE;
+	for (int ii = 1; ii < argc; ii++)
+	{
+		if (std::string(argv[ii]) == "--vertex-bench") vertex_benchmark = true;
+		if (std::string(argv[ii]) == "--light-bench") light_benchmark = true;
+		if (std::string(argv[ii]) == "--ecs-bench") ecs_benchmark = true;
+		if (std::string(argv[ii]) == "--headless") headless = true;
+		if (std::string(argv[ii]) == "--frames" && ii + 1 < argc) headless_frames = atoi(argv[++ii]);
+		if (std::string(argv[ii]) == "--dump" && ii + 1 < argc) dump_path = argv[++ii];
+		if (std::string(argv[ii]) == "--bench" && ii + 1 < argc) bench_path = argv[++ii];
+		if (std::string(argv[ii]) == "--compare" && ii + 2 < argc)
+		{
+			compare_paths[0] = argv[++ii];
+			compare_paths[1] = argv[++ii];
+		}
+		if (std::string(argv[ii]) == "--tolerance" && ii + 1 < argc) tolerance = atof(argv[++ii]);
+		if (std::string(argv[ii]) == "--trace" && ii + 1 < argc)
+		{
+			trace_path = argv[++ii];
+			toggle_trace();
+		}
+		if (std::string(argv[ii]) == "--camera" && ii + 1 < argc && !camera_script.load(argv[++ii]))
+		{
+			std::cout << "Couldn't read a camera script from " << argv[ii] << std::endl;
+			return -1;
+		}
+		if (std::string(argv[ii]) == "--toggle" && ii + 1 < argc)
+		{
+			for (const char* key = argv[++ii]; *key != '\0'; key++)
+			{
+				if (!toggle_option(*key)) std::cout << "No option toggles with " << *key << std::endl;
+			}
+		}
+		if (std::string(argv[ii]) == "--fps" && ii + 1 < argc) target_fps = atof(argv[++ii]);
+		if (std::string(argv[ii]) == "--tick-rate" && ii + 1 < argc)
+		{
+			tick_rate = atof(argv[++ii]);
+			if (tick_rate <= 0.0) tick_rate = DEFAULT_TICK_RATE;
+		}
+		if (std::string(argv[ii]) == "--swap" && ii + 1 < argc)
+		{
+			std::string mode = argv[++ii];
+			if (mode == swapModeName(SWAP_IMMEDIATE)) swap_mode = SWAP_IMMEDIATE;
+			if (mode == swapModeName(SWAP_VSYNC)) swap_mode = SWAP_VSYNC;
+			if (mode == swapModeName(SWAP_ADAPTIVE)) swap_mode = SWAP_ADAPTIVE;
+		}
+	}
 
-	// glfw window creation
-	GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, GAME_TITLE, NULL, NULL);
-	if (window == NULL)
+	// Compare two benchmark runs instead of playing; fails if the second regressed
+	if (!compare_paths[0].empty())
 	{
-		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
-		return -1;
+		return compareBenchmarks(compare_paths[0], compare_paths[1], tolerance, std::cout) == 0 ? 0 : 1;
 	}
-	glfwMakeContextCurrent(window);
 
-	// Callback functions 
-	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-	glfwSetCursorPosCallback(window, mouse_callback);
+	// Time the entity systems with up to 100k entities instead of playing; needs no GL
+	if (ecs_benchmark)
+	{
+		runEcsBenchmark(std::cout);
+		return 0;
+	}
 
-	// Capture and fixate cursor
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	// Benchmarks fly along a recorded path (unless given another) and are stepped like headless
+	// runs, so every one sees the same frames; rand() is seeded for the same reason
+	bool scripted = headless || !bench_path.empty();
+	if (!bench_path.empty())
+	{
+		if (camera_script.isEmpty() && !camera_script.load(FileSystem::getPath(BENCH_PATH)))
+		{
+			std::cout << "Couldn't read the benchmark path " << BENCH_PATH << std::endl;
+			return -1;
+		}
+		if (headless_frames <= 0) headless_frames = (int)ceil(camera_script.getDuration() * tick_rate) + 1;
+		srand(BENCH_SEED);
+	}
+	if (headless_frames <= 0) headless_frames = DEFAULT_HEADLESS_FRAMES;
 
-	// glad: load all OpenGL function pointers
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	// Headless runs draw offscreen, with no window (so window stays NULL)
+	GLFWwindow* window = NULL;
+	HeadlessContext* headless_context = NULL;
+	if (headless)
 	{
-		std::cout << "Failed to initialize GLAD" << std::endl;
-		return -1;
+		headless_context = new HeadlessContext();
+		if (!headless_context->create(SCR_WIDTH, SCR_HEIGHT))
+		{
+			std::cout << "Failed to create a headless context" << std::endl;
+			delete headless_context;
+			return -1;
+		}
+	}
+	else
+	{
+		// glfw: initialize and configure
+		glfwInit();
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);	
+
+		// glfw window creation
+		window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, GAME_TITLE, NULL, NULL);
+		if (window == NULL)
+		{
+			std::cout << "Failed to create GLFW window" << std::endl;
+			glfwTerminate();
+			return -1;
+		}
+		glfwMakeContextCurrent(window);
+
+		// Callback functions 
+		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+		glfwSetCursorPosCallback(window, mouse_callback);
+
+		// Capture and fixate cursor
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+		// glad: load all OpenGL function pointers
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+		{
+			std::cout << "Failed to initialize GLAD" << std::endl;
+			return -1;
+		}
 	}
 
 	// Configure global opengl state
-	glEnable(GL_DEPTH_TEST);
+	glState().enable(GL_DEPTH_TEST);
+
+	// Frame pacing: how swaps meet the display, and the most frames a second to present
+	frame_pacer = new FramePacer();
+	if (window != NULL) frame_pacer->setMode(swap_mode);
+	frame_pacer->setTargetRate(target_fps);
 
 	// Build and compile our shader zprogram
 	Shader lighting_shader("./sample2.vs", "./sample2.fs");
 	light = &lighting_shader;
+	Shader depth_shader("./sample2.vs", "./depth.fs");
 	
-	// Set up vertex data (and buffer(s)) and configure vertex attributes
-	unsigned int VBO_box, VAO_box;
-
-	glGenVertexArrays(1, &VAO_box);
-	glGenBuffers(1, &VBO_box);
-
-	glBindVertexArray(VAO_box);
-
-	glBindBuffer(GL_ARRAY_BUFFER, VBO_box);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(box), box, GL_STATIC_DRAW);
-
-	//vertex coordinates
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	//normal vectors
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	//texture coordinates
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
+	// Per-instance model and normal matrices, so parts sharing the same state can be drawn
+	// in one call. Matrix attributes take up one location per column.
+	unsigned int VBO_instance;
+	glGenBuffers(1, &VBO_instance);
+	glState().bindBuffer(GL_ARRAY_BUFFER, VBO_instance);
+	glBufferData(GL_ARRAY_BUFFER, MAX_INSTANCES * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+
+	// Set up vertex data (and buffer(s)) and configure vertex attributes. The box is welded
+	// to its 24 unique vertices, indexed, and packed.
+	PrimitiveMesh* box_mesh = new PrimitiveMesh(
+		box, sizeof(box) / (VERTEX_FLOATS * sizeof(float)), VBO_instance);
+	unsigned int VAO_box = box_mesh->getVAO();
 
 	// second, configure the light's VAO (VBO stays the same; the vertices are the same for the light object which is also a 3D cube)
 	unsigned int VAO_light;
 	glGenVertexArrays(1, &VAO_light);
-	glBindVertexArray(VAO_light);
+	glState().bindVertexArray(VAO_light);
 
-	glBindBuffer(GL_ARRAY_BUFFER, VBO_box);
+	glState().bindBuffer(GL_ARRAY_BUFFER, box_mesh->getVBO());
 	// note that we update the lamp's position attribute's stride to reflect the updated buffer data
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)0);
 	glEnableVertexAttribArray(0);
 
+	// Scenery that never moves is baked into one buffer, drawn once per material
+	static_batch = new StaticBatch(*box_mesh, VBO_instance);
+
 	// Textures
 	wood_textures = new unsigned int[2];
 	brick_textures = new unsigned int[2];
@@ -362,148 +575,352 @@ int main()
 	// Initialise WORLD and ENTITIES
 	// ------------------------------------------------------------------------------------------
 
+	// Cells, joined through the doorway (shut while the door stands)
+	for (int ii = 0; ii < (int)(sizeof(cell_mins) / sizeof(cell_mins[0])); ii++)
+	{
+		cell_graph.addCell(cell_mins[ii], cell_maxs[ii]);
+	}
+	door_portal = cell_graph.addPortal(0, 1,
+		door_positions[0] - door_scales[0] / 2.0f, door_positions[0] + door_scales[0] / 2.0f);
+
 	start();
 	
 	// Shader configuration 
-	lighting_shader.use();
-	lighting_shader.setInt("material.diffuse", 0);
-	lighting_shader.setInt("material.specular", 1);
-
-	// Define projection matricies and pass to shader
-	// Can toggle between the two
+	glState().useProgram(lighting_shader.ID);
+	lighting_shader.setInt("diffuseMap", 0);
+	lighting_shader.setInt("specularMap", 1);
+	lighting_shader.setBool("instanced", false);
+	lighting_shader.setInt("pointLights", POINT_LIGHTS_UNIT);
+	lighting_shader.setInt("clusterRanges", CLUSTER_RANGES_UNIT);
+	lighting_shader.setInt("clusterLights", CLUSTER_LIGHTS_UNIT);
+	lighting_shader.setInt("staticShadows", SHADOW_UNIT);
+	lighting_shader.setInt("dynamicShadows", SHADOW_UNIT + 1);
+
+	// Camera, light and material uniforms are shared through uniform buffers
+	UniformBlocks uniform_blocks;
+	uniform_blocks.bind(lighting_shader);
+	uniform_blocks.bind(depth_shader);
+
+	// Point lights are sorted into clusters of the view, so each fragment only visits the
+	// ones that reach it
+	ClusterGrid cluster_grid;
+	std::vector<LightBlock> point_lights;
+
+	// The alternative to shading as the scene is drawn: fill a G-buffer, then light it
+	DeferredRenderer* deferred_renderer = new DeferredRenderer(uniform_blocks);
+
+	// Define projection matricies, can toggle between the two
 	perspective = glm::perspective(
-		glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 300.0f);
+		glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, VIEW_DISTANCE);
 	orthographic = glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, 5.0f, 100.0f);
-	light->setMat4("projection", perspective);
+
+	// Compare vertex shader throughput instead of playing
+	if (vertex_benchmark)
+	{
+		runVertexBenchmark(VAO_box, VBO_instance, uniform_blocks);
+		delete headless_context;
+		glfwTerminate();
+		return 0;
+	}
+
+	// Time clustered lighting with more and more point lights instead of playing
+	if (light_benchmark)
+	{
+		int bench_width, bench_height;
+		framebuffer_size(window, bench_width, bench_height);
+		runLightBenchmark(window, bench_width, bench_height, lighting_shader, VAO_box, VBO_instance,
+			wood_textures, uniform_blocks, perspective, NEAR_PLANE, VIEW_DISTANCE);
+		delete headless_context;
+		glfwTerminate();
+		return 0;
+	}
+
+	// Draws are collected and sorted before being submitted
+	RenderQueue render_queue(VBO_instance, VIEW_DISTANCE);
+	if (!RenderQueue::supportsIndirect())
+	{
+		std::cout << "Indirect drawing needs OpenGL 4.3, falling back to instancing" << std::endl;
+	}
+	FrameStats frame_stats;
+	double last_stats = 0.0;
+	GpuTimer scene_timer("scene"), lighting_timer("lighting"), shadow_timer("shadows");
+
+	// Shadows of the main light, drawn through a queue of their own. Cells and the view
+	// frustum say nothing about what the light sees, so it doesn't cull.
+	PointShadowMap* shadow_map = new PointShadowMap();
+	RenderQueue shadow_queue(VBO_instance, VIEW_DISTANCE);
+	shadow_queue.setFrustumCulling(false);
+
+	// Hand the world as it starts to the renderer, then let the simulation run on its own.
+	// Headless runs and benchmarks step it themselves instead (see step_scripted()).
+	input_buffer.write() = input_state;
+	input_buffer.publish();
+	take_snapshot(snapshot_buffer.write(), input_state, clockSeconds());
+	snapshot_buffer.publish();
+	simulating = true;
+	std::thread simulation;
+	if (!scripted) simulation = std::thread(simulation_loop);
+	SnapshotBlender snapshot_blender;
+	std::vector<double> frame_times; // scripted runs only
+	BenchmarkRecorder bench_recorder;
+	last_frame = clockSeconds();
+	PROFILE_THREAD("render");
 
 	// Render Loop
-	while (!glfwWindowShouldClose(window))
+	while (scripted ? (int)frame_times.size() < headless_frames && (headless || !glfwWindowShouldClose(window))
+		: !glfwWindowShouldClose(window))
 	{	
 		// Per-frame time logic
-		float currentFrame = glfwGetTime();
+		PROFILE_ZONE("frame");
+		double currentFrame = clockSeconds();
 		delta_time = currentFrame - last_frame;
 		last_frame = currentFrame;
 
-		// Input
-		process_input(window);
+		// Start this frame's counters
+		frame_stats.reset();
+		lighting_shader.resetCounters();
+		glState().beginFrame();
+
+		// Input, then the world as it was a tick ago, blended between the ticks either side so
+		// motion is smooth at any frame rate. Scripted, each frame is a tick of its own.
+		if (scripted) step_scripted((int)frame_times.size());
+		else process_input(window);
+		const FrameSnapshot& frame = scripted ? snapshot_buffer.read()
+			: snapshot_blender.blend(snapshot_buffer.read(), clockSeconds() - 1.0 / tick_rate);
 
 		// Render
 		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); 
 
-		// Activate shader
-		lighting_shader.use();
-		light = &lighting_shader;
-		lighting_shader.setVec3("light.position", light_source->getPosition());
-	    lighting_shader.setVec3("viewPos", light_source->getPosition());
+		// Camera, light and material state, uploaded to every shader in one go
+		uniform_blocks.camera.view = glm::lookAt(
+			frame.cameraPos, frame.cameraPos + frame.cameraFront, frame.cameraUp
+		);
+		uniform_blocks.camera.projection = PERSPECTIVE_PROJECTION ? perspective : orthographic;
+		uniform_blocks.camera.viewPos = frame.lightPos;
 
 		// Light properties
-		lighting_shader.setVec3("light.ambient", 0.1f, 0.1f, 0.1f);
-		lighting_shader.setVec3("light.diffuse", 0.8f, 0.8f, 0.8f);
-		lighting_shader.setVec3("light.specular", 1.0f, 1.0f, 1.0f);
-		lighting_shader.setFloat("light.constant", 1.0f);
+		uniform_blocks.light.position = frame.lightPos;
+		uniform_blocks.light.ambient = glm::vec3(0.1f, 0.1f, 0.1f);
+		uniform_blocks.light.diffuse = glm::vec3(0.8f, 0.8f, 0.8f);
+		uniform_blocks.light.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+		uniform_blocks.light.constant = 1.0f;
 
 		if (SCENERY_DARK)
 		{
-			lighting_shader.setFloat("light.linear", 0.001f);
-			lighting_shader.setFloat("light.quadratic", lightSourceRadius);
+			uniform_blocks.light.linear = 0.001f;
+			uniform_blocks.light.quadratic = frame.lightRadius;
 		}
 		else
 		{
-			lighting_shader.setVec3("light.ambient", 1.0f, 1.0f, 1.0f);	
-			lighting_shader.setFloat("light.linear", 0.0f);
-			lighting_shader.setFloat("light.quadratic", 0.0f);
+			uniform_blocks.light.ambient = glm::vec3(1.0f, 1.0f, 1.0f);
+			uniform_blocks.light.linear = 0.0f;
+			uniform_blocks.light.quadratic = 0.0f;
 		} 
+
+		// The light casts shadows as far as it reaches, so only in the dark
+		uniform_blocks.light.shadowFar = SCENERY_DARK && SHADOWS ? lightRange(uniform_blocks.light) : 0.0f;
 		
 		// Material properties
-        lighting_shader.setFloat("material.shininess", 32.0f);
-
-		// Camera/view transformation
-		glm::mat4 view = glm::lookAt(
-			cam->getPosition(), cam->getPosition() + cam->getFront(), cam->getUp()
-		);
-		light->setMat4("view", view);
-
-		// Declare transformation matrix
-		glm::mat4 model = glm::mat4();
+		uniform_blocks.material.shininess = 32.0f;
 
-		// Handle perspective switch
-		if (PROJECTION_UPDATED)
+		// In the dark, the pickups still lying around glow
+		point_lights.clear();
+		if (SCENERY_DARK && GLOWING_PICKUPS)
 		{
-			if (PERSPECTIVE_PROJECTION)
+			for (size_t ii = 0; ii < frame.glows.size(); ii++)
 			{
-				light->setMat4("projection", perspective);
-			}
-			else
-			{
-				light->setMat4("projection", orthographic);
+				point_lights.push_back(glowLight(frame.glows[ii]));
 			}
 		}
+		int fb_width, fb_height;
+		framebuffer_size(window, fb_width, fb_height);
+		if (PERSPECTIVE_PROJECTION)
+		{
+			cluster_grid.setProjection(perspective, NEAR_PLANE, VIEW_DISTANCE, fb_width, fb_height);
+		}
+		else
+		{
+			cluster_grid.setProjection(orthographic, 5.0f, 100.0f, fb_width, fb_height);
+		}
+		cluster_grid.build(point_lights, uniform_blocks.camera.view);
+		cluster_grid.upload();
+		uniform_blocks.clusters = cluster_grid.getBlock();
+
+		uniform_blocks.upload();
 
 		// Draw objects
 		// --------------------------------------------------------------------------------------
-	
-		//Street
-		glBindVertexArray(VAO_box); 
-
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, road_textures[0]);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, road_textures[1]);
-
-		model = glm::mat4();
-		model = glm::scale(model, glm::vec3(10.0f, 0.001f, WORLD_LENGTH));
-
-		light->setMat4("model", model);
+		render_queue.setInstancing(INSTANCED_RENDERING);
+		render_queue.setIndirect(INDIRECT_RENDERING);
+		render_queue.setFrontToBack(FRONT_TO_BACK);
+		render_queue.setDepthPrepass(DEPTH_PREPASS ? &depth_shader : NULL);
+		render_queue.setShadingShader(DEFERRED_SHADING ? &deferred_renderer->getGeometryShader() : NULL);
+		render_queue.setCountOverdraw(SHOW_STATS);
+		render_queue.setFrustumCulling(FRUSTUM_CULLING);
+		render_queue.setCellCulling(CELL_CULLING);
+		render_queue.setLightCulling(LIGHT_CULLING);
+		render_queue.begin(frame.cameraPos,
+			uniform_blocks.camera.projection * uniform_blocks.camera.view);
+
+		// Find the cells that can be seen through open portals
+		cell_graph.setPortalOpen(door_portal, frame.doorOpen);
+		cell_graph.update(frame.cameraPos, render_queue.getFrustum());
+		render_queue.setCells(&cell_graph);
+
+		// In the dark, nothing past the lights' reach can show
+		render_queue.clearLightRanges();
+		render_queue.addLightRange(uniform_blocks.light.position,
+			SCENERY_DARK ? lightRange(uniform_blocks.light) : -1.0f);
+		for (size_t ii = 0; ii < point_lights.size(); ii++)
+		{
+			render_queue.addLightRange(point_lights[ii].position, lightRange(point_lights[ii]));
+		}
 
-		glDrawArrays(GL_TRIANGLES, 0, 36);
+		// Collect the static scenery, re-baking it first if any of it changed
+		static_batch->setScenery(frame.scenery, frame.sceneryRevision);
+		static_batch->render(render_queue, *light);
 
-		//Grass
-		glBindVertexArray(VAO_box);
+		// Collect the entities and pickups
+		for (size_t ii = 0; ii < frame.entities.size(); ii++)
+		{
+			submitEntity(render_queue, frame, frame.entities[ii], VAO_box, *light);
+		}
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, grass_textures[0]);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, grass_textures[1]);
+		// Draw the shadow casters around the light: the static scenery only when its cached
+		// cube is out of date, things that move every frame. The light's own model is left
+		// out, as the light sits inside it. The GPU time of each pass is reported with the
+		// stats, and recorded by benchmarks and traces.
+		bool time_gpu = SHOW_STATS || !bench_path.empty() || profiler().isRecording();
+		if (uniform_blocks.light.shadowFar > 0.0f)
+		{
+			PROFILE_ZONE("shadows");
+			if (time_gpu) shadow_timer.begin();
+			shadow_queue.setInstancing(INSTANCED_RENDERING);
+			shadow_queue.setIndirect(INDIRECT_RENDERING);
+			shadow_queue.setShadingShader(&shadow_map->getShader());
+			shadow_map->setLight(uniform_blocks.light.position, uniform_blocks.light.shadowFar);
+
+			if (shadow_map->staticStale(static_batch->getRevision()))
+			{
+				shadow_map->beginStatic(static_batch->getRevision());
+				shadow_queue.begin(uniform_blocks.light.position, glm::mat4());
+				static_batch->render(shadow_queue, *light);
+				shadow_queue.flush(frame_stats);
+			}
 
-		model = glm::mat4();
-		model = glm::translate(model, glm::vec3(0.0f, -0.01f, 0.0f));
-		model = glm::scale(model, glm::vec3(WORLD_WIDTH, 0.001f, WORLD_LENGTH));
+			shadow_map->beginDynamic();
+			shadow_queue.begin(uniform_blocks.light.position, glm::mat4());
+			for (size_t ii = 0; ii < frame.entities.size(); ii++)
+			{
+				const EntitySnapshot& entity = frame.entities[ii];
+				if (!entity.castsShadow) continue;
+				for (int jj = entity.firstPart; jj < entity.firstPart + entity.numParts; jj++)
+				{
+					shadow_queue.submit(*light, VAO_box, entity.textures, entity.numTextures,
+						frame.partModels[jj]);
+				}
+			}
+			shadow_queue.flush(frame_stats);
 
-		light->setMat4("model", model);
+			shadow_map->end(fb_width, fb_height);
+			shadow_map->bind();
+			if (time_gpu) shadow_timer.end();
+		}
 
-		glDrawArrays(GL_TRIANGLES, 0, 36);
-		
-		// Render the entities
-		std::list<Entity*>::iterator it1 = entities.begin();
-		for (int ii = 0; ii < (int)(entities.size()); ii++)
+		// Sort and submit everything in as few state changes as possible, into the G-buffer
+		// when shading is deferred
+		if (DEFERRED_SHADING) deferred_renderer->beginGeometry(fb_width, fb_height);
+		if (time_gpu) scene_timer.begin();
+		render_queue.flush(frame_stats);
+		if (time_gpu) scene_timer.end();
+		if (DEFERRED_SHADING)
 		{
-			(*it1)->render(VAO_box, *light);
-			std::advance(it1, 1);
+			if (time_gpu) lighting_timer.begin();
+			deferred_renderer->light(frame_stats,
+				uniform_blocks.camera.projection * uniform_blocks.camera.view, cluster_grid.getNumLights());
+			if (time_gpu) lighting_timer.end();
 		}
-
-		// Render the pickups
-		INTERACTIVITY_CLOSE_ENOUGH = false;
-		std::list<Pickup*>::iterator it2 = pickups.begin();
-		for (int ii = 0; ii < (int)(pickups.size()); ii++)
-		{	
-			(*it2)->render(VAO_box, *light);
-			if (is_close_to((*it2)->getPosition()))
-			{
-				INTERACTIVITY_CLOSE_ENOUGH = true;
-				closest_pickup_idx = ii; 
-			}
-			std::advance(it2, 1);
+		frame_stats.uniformUploads += lighting_shader.uploadsIssued;
+		frame_stats.uniformSkips += lighting_shader.uploadsSkipped;
+		frame_stats.glCallsIssued += glState().getIssued();
+		frame_stats.glCallsElided += glState().getElided();
+		frame_stats.pointLights = cluster_grid.getNumLights();
+		frame_stats.lightReferences = cluster_grid.getNumReferences();
+		frame_stats.clusterTime = cluster_grid.getBuildTime();
+		frame_stats.deferred = DEFERRED_SHADING;
+		frame_stats.frameTime = delta_time;
+		frame_stats.sceneGpuTime = scene_timer.getMilliseconds();
+		frame_stats.lightingGpuTime = lighting_timer.getMilliseconds();
+		frame_stats.shadowGpuTime = uniform_blocks.light.shadowFar > 0.0f ? shadow_timer.getMilliseconds() : 0.0;
+		frame_stats.shadowStaticRedraws = shadow_map->getStaticRedraws();
+		FrameTiming pacing = frame_pacer->getAverage(PACER_HISTORY);
+		frame_stats.swapMode = swapModeName(frame_pacer->getMode());
+		frame_stats.targetRate = frame_pacer->getTargetRate();
+		frame_stats.cpuTime = pacing.cpu;
+		frame_stats.waitTime = pacing.wait;
+		frame_stats.presentTime = pacing.present;
+
+		// Report the frame stats about once a second
+		if (SHOW_STATS && currentFrame - last_stats >= 1.0)
+		{
+			frame_stats.print(std::cout);
+			last_stats = currentFrame;
 		}
 	
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		double presenting = clockSeconds();
+		frame_pacer->present(window);
+		if (scripted) frame_times.push_back(clockSeconds() - currentFrame);
+		if (!bench_path.empty())
+		{
+			BenchFrame bench_frame;
+			bench_frame.frameMs = frame_times.back() * 1e3;
+			bench_frame.cpuMs = (presenting - currentFrame) * 1e3;
+			bench_frame.gpuMs = frame_stats.sceneGpuTime + (DEFERRED_SHADING ? frame_stats.lightingGpuTime : 0.0)
+				+ frame_stats.shadowGpuTime;
+			bench_frame.drawCalls = frame_stats.drawCalls;
+			bench_frame.binds = frame_stats.bindsIssued;
+			bench_frame.stateChanges = frame_stats.glCallsIssued;
+			bench_frame.uniformUploads = frame_stats.uniformUploads;
+			bench_recorder.record(bench_frame);
+		}
+		if (window != NULL) glfwPollEvents();
+	}
+	simulating = false;
+	if (simulation.joinable()) simulation.join();
+
+	// Headless runs end with their timings, and the last frame if asked for
+	if (headless)
+	{
+		if (!dump_path.empty() && !headless_context->savePpm(dump_path.c_str()))
+		{
+			std::cout << "Couldn't write " << dump_path << std::endl;
+		}
+		printHeadlessTimings(frame_times, std::cout);
+	}
+
+	// A capture still running is written out
+	if (profiler().isRecording()) toggle_trace();
+
+	// Benchmarks end with their summary, for --compare
+	if (!bench_path.empty())
+	{
+		std::ofstream bench_file(bench_path.c_str());
+		bench_recorder.writeJson(bench_file, bench_options(headless));
+		if (!bench_file) std::cout << "Couldn't write " << bench_path << std::endl;
+		else std::cout << "Benchmark: " << bench_recorder.getCount() << " frames written to " << bench_path << std::endl;
 	}
 
 	// De-allocate all resources once they've outlived their purpose:
-	glDeleteVertexArrays(1, &VAO_box);
-	glDeleteBuffers(1, &VBO_box);
+	glState().deleteVertexArray(VAO_light);
+	glState().deleteBuffer(VBO_instance);
+	delete static_batch;
+	delete box_mesh;
+	delete deferred_renderer;
+	delete shadow_map;
+	delete frame_pacer;
+	delete headless_context;
 
 	delete wood_textures;
 	delete grass_textures;
@@ -516,82 +933,67 @@ int main()
 }
 
 // process all input: query GLFW whether relevant keys are pressed/released this frame and 
-// react accordingly.
+// react accordingly. Rendering options change here; what the player does is handed to the
+// simulation (see simulate()).
 // ---------------------------------------------------------------------------------------
 void process_input(GLFWwindow *window)
 {
+	PROFILE_ZONE("process_input");
+
 	// Exit
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) 
 	{
 		glfwSetWindowShouldClose(window, true);
 	}
 
-	// Double speed when "Shift" pressed
-	if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_RELEASE)
-		cam->setSpeed(2.5 * delta_time); 
-	else
-		cam->setSpeed(2.5 * delta_time * 2);
-	
-	// Move around
-	if (cam->isAlive()) {
-		float cameraSpeed = cam->getSpeed();
-		glm::vec3 newPos;
-		if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS && 
-	    	!collisionAt(cam->getPosition() + cameraSpeed * player->getFront())) {
-			cam->move(cameraSpeed * player->getFront());
-			player->move(cameraSpeed * player->getFront());
-		}
-		if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS &&
-			!collisionAt(cam->getPosition() - cameraSpeed * player->getFront())) {
-			cam->move(-cameraSpeed * player->getFront());
-			player->move(-cameraSpeed * player->getFront());
-		}
-		if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS && 
-			!collisionAt(cam->getPosition() - cam->getRight() * cameraSpeed)) {
-			cam->move(-cam->getRight() * cameraSpeed);
-			player->move(-cam->getRight() * cameraSpeed);
-		}
-		if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS && 
-			!collisionAt(cam->getPosition() + cam->getRight() * cameraSpeed)) {
-			cam->move(cam->getRight() * cameraSpeed);
-			player->move(cam->getRight() * cameraSpeed);
-		}
-	} 
+	// Moving, running, picking up and the light's reach
+	input_state.forward = glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS;
+	input_state.back = glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS;
+	input_state.left = glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS;
+	input_state.right = glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
+	input_state.run = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS;
+	input_state.interact = glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS;
+	input_state.brighter = glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS;
+	input_state.dimmer = glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS;
+
+	// Presses shorter than a tick still count
+	static bool canInteract = true;
+	if (input_state.interact && canInteract)
+	{
+		input_state.interactions++;
+		canInteract = false;
+	}
+	if (!input_state.interact) canInteract = true;
 
 	// Restart
 	static bool canRestart = true;
 	if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS && canRestart) 
 	{
-		start(); 
+		input_state.restarts++;
 		canRestart = false;
 	}
 	if (glfwGetKey(window, GLFW_KEY_R) == GLFW_RELEASE) canRestart = true;
-	
-	// Pick stuff up
-	if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS && INTERACTIVITY_CLOSE_ENOUGH)
+
+	// Levels of detail go by how big things look, which nothing changes in orthographic. A
+	// minimised window has no height, so the last real one is kept.
+	static float lod_scale = 1.0f;
+	int fb_width, fb_height;
+	framebuffer_size(window, fb_width, fb_height);
+	if (fb_height > 0)
 	{
-		std::list<Pickup*>::iterator it = pickups.begin();
-		std::advance(it, closest_pickup_idx);
-		pickups.erase(it);
-	
-		if ((*it) == (torch)) {
-			cam->setItemVisible(true);
-			light_source = cam;
-		} else {
-			num_items_found += 1;
-			if (num_items_found == 4) {
-				ALL_ITEMS_FOUND = true;
-				door->setVisible(false);
-			}
-		}
+		lod_scale = (float)fb_height / SCR_HEIGHT;
+		if (lod_scale < MIN_LOD_SCALE) lod_scale = MIN_LOD_SCALE;
 	}
+	input_state.lodScale = LEVELS_OF_DETAIL && PERSPECTIVE_PROJECTION ? lod_scale : 0.0f;
+
+	input_buffer.write() = input_state;
+	input_buffer.publish();
 
 	// Perspective shift
 	static bool canShift = true;
 	if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS && canShift) 
 	{
 		PERSPECTIVE_PROJECTION = !PERSPECTIVE_PROJECTION;
-		PROJECTION_UPDATED = true;
 		canShift = false;
 	}
 	if (glfwGetKey(window, GLFW_KEY_P) == GLFW_RELEASE) canShift = true; 
@@ -605,31 +1007,410 @@ void process_input(GLFWwindow *window)
 	}
 	if (glfwGetKey(window, GLFW_KEY_O) == GLFW_RELEASE) canScene = true; 
 
+	// Forward and deferred shading toggle
+	static bool canDefer = true;
+	if (glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS && canDefer)
+	{
+		DEFERRED_SHADING = !DEFERRED_SHADING;
+		canDefer = false;
+	}
+	if (glfwGetKey(window, GLFW_KEY_B) == GLFW_RELEASE) canDefer = true;
+
+	// Instanced rendering toggle
+	static bool canInstance = true;
+	if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS && canInstance)
+	{
+		INSTANCED_RENDERING = !INSTANCED_RENDERING;
+		canInstance = false;
+	}
+	if (glfwGetKey(window, GLFW_KEY_I) == GLFW_RELEASE) canInstance = true;
+
+	// Multi-draw indirect toggle
+	static bool canIndirect = true;
+	if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS && canIndirect)
+	{
+		INDIRECT_RENDERING = !INDIRECT_RENDERING;
+		canIndirect = false;
+	}
+	if (glfwGetKey(window, GLFW_KEY_M) == GLFW_RELEASE) canIndirect = true;
+
+	// Depth pre-pass toggle
+	static bool canPrepass = true;
+	if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS && canPrepass)
+	{
+		DEPTH_PREPASS = !DEPTH_PREPASS;
+		canPrepass = false;
+	}
+	if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_RELEASE) canPrepass = true;
+
+	// Front-to-back sorting toggle
+	static bool canSort = true;
+	if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS && canSort)
+	{
+		FRONT_TO_BACK = !FRONT_TO_BACK;
+		canSort = false;
+	}
+	if (glfwGetKey(window, GLFW_KEY_F) == GLFW_RELEASE) canSort = true;
+
+	// Frustum culling toggle
+	static bool canCull = true;
+	if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS && canCull)
+	{
+		FRUSTUM_CULLING = !FRUSTUM_CULLING;
+		canCull = false;
+	}
+	if (glfwGetKey(window, GLFW_KEY_C) == GLFW_RELEASE) canCull = true;
+
+	// Cell and portal culling toggle
+	static bool canCullCells = true;
+	if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS && canCullCells)
+	{
+		CELL_CULLING = !CELL_CULLING;
+		canCullCells = false;
+	}
+	if (glfwGetKey(window, GLFW_KEY_X) == GLFW_RELEASE) canCullCells = true;
+
+	// Light range culling toggle
+	static bool canCullUnlit = true;
+	if (glfwGetKey(window, GLFW_KEY_U) == GLFW_PRESS && canCullUnlit)
+	{
+		LIGHT_CULLING = !LIGHT_CULLING;
+		canCullUnlit = false;
+	}
+	if (glfwGetKey(window, GLFW_KEY_U) == GLFW_RELEASE) canCullUnlit = true;
+
+	// Glowing pickups toggle
+	static bool canGlow = true;
+	if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS && canGlow)
+	{
+		GLOWING_PICKUPS = !GLOWING_PICKUPS;
+		canGlow = false;
+	}
+	if (glfwGetKey(window, GLFW_KEY_G) == GLFW_RELEASE) canGlow = true;
+
+	// Shadows toggle
+	static bool canShadow = true;
+	if (glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS && canShadow)
+	{
+		SHADOWS = !SHADOWS;
+		canShadow = false;
+	}
+	if (glfwGetKey(window, GLFW_KEY_H) == GLFW_RELEASE) canShadow = true;
+
+	// Levels of detail toggle
+	static bool canLod = true;
+	if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS && canLod)
+	{
+		LEVELS_OF_DETAIL = !LEVELS_OF_DETAIL;
+		canLod = false;
+	}
+	if (glfwGetKey(window, GLFW_KEY_N) == GLFW_RELEASE) canLod = true;
+
+	// Swap mode, immediate -> vsync -> adaptive (where supported)
+	static bool canSwap = true;
+	if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS && canSwap)
+	{
+		SwapMode next = (SwapMode)((frame_pacer->getMode() + 1) % 3);
+		if (frame_pacer->setMode(next) != next) frame_pacer->setMode(SWAP_IMMEDIATE);
+		canSwap = false;
+	}
+	if (glfwGetKey(window, GLFW_KEY_V) == GLFW_RELEASE) canSwap = true;
+
+	// Trace capture, started on one press and written out on the next
+	static bool canTrace = true;
+	if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS && canTrace)
+	{
+		toggle_trace();
+		canTrace = false;
+	}
+	if (glfwGetKey(window, GLFW_KEY_T) == GLFW_RELEASE) canTrace = true;
+
+	// Frame stats toggle
+	static bool canStats = true;
+	if (glfwGetKey(window, GLFW_KEY_F1) == GLFW_PRESS && canStats)
+	{
+		SHOW_STATS = !SHOW_STATS;
+		canStats = false;
+	}
+	if (glfwGetKey(window, GLFW_KEY_F1) == GLFW_RELEASE) canStats = true;
+
+}
+
+// Flip the option pressing key would (P, O, B, ... as in process_input()), e.g. from the
+// command line; false if no option goes with it
+// ---------------------------------------------------------------------------------------
+bool toggle_option(char key)
+{
+	switch (toupper(key))
+	{
+		case 'P': PERSPECTIVE_PROJECTION = !PERSPECTIVE_PROJECTION; return true;
+		case 'O': SCENERY_DARK = !SCENERY_DARK; return true;
+		case 'B': DEFERRED_SHADING = !DEFERRED_SHADING; return true;
+		case 'I': INSTANCED_RENDERING = !INSTANCED_RENDERING; return true;
+		case 'M': INDIRECT_RENDERING = !INDIRECT_RENDERING; return true;
+		case 'Z': DEPTH_PREPASS = !DEPTH_PREPASS; return true;
+		case 'F': FRONT_TO_BACK = !FRONT_TO_BACK; return true;
+		case 'C': FRUSTUM_CULLING = !FRUSTUM_CULLING; return true;
+		case 'X': CELL_CULLING = !CELL_CULLING; return true;
+		case 'U': LIGHT_CULLING = !LIGHT_CULLING; return true;
+		case 'G': GLOWING_PICKUPS = !GLOWING_PICKUPS; return true;
+		case 'H': SHADOWS = !SHADOWS; return true;
+		case 'N': LEVELS_OF_DETAIL = !LEVELS_OF_DETAIL; return true;
+		default: return false;
+	}
+}
+
+// What a benchmark measured, for telling runs that can't be compared apart: the options
+// that change what's drawn and how, the tick rate, and whether there was a window
+// ---------------------------------------------------------------------------------------
+std::string bench_options(bool headless)
+{
+	std::ostringstream options;
+	options << (SCENERY_DARK ? "dark" : "light")
+		<< (DEFERRED_SHADING ? " deferred" : " forward")
+		<< (PERSPECTIVE_PROJECTION ? "" : " orthographic")
+		<< (INSTANCED_RENDERING ? " instanced" : "")
+		<< (INDIRECT_RENDERING ? " indirect" : "")
+		<< (DEPTH_PREPASS ? " prepass" : "")
+		<< (FRONT_TO_BACK ? " front-to-back" : "")
+		<< (FRUSTUM_CULLING ? " frustum-culling" : "")
+		<< (CELL_CULLING ? " cell-culling" : "")
+		<< (LIGHT_CULLING ? " light-culling" : "")
+		<< (GLOWING_PICKUPS ? " glows" : "")
+		<< (SHADOWS ? " shadows" : "")
+		<< (LEVELS_OF_DETAIL ? " lod" : "")
+		<< ", " << tick_rate << " ticks/s"
+		<< (headless ? ", headless" : ", windowed");
+	return options.str();
+}
+
+// Start a trace capture (see profiler.hpp), or stop the one running and write it to
+// trace_path. Only builds with ENABLE_PROFILER have anything to capture.
+// ---------------------------------------------------------------------------------------
+void toggle_trace()
+{
+	if (!PROFILER_BUILT)
+	{
+		std::cout << "Tracing needs a build with ENABLE_PROFILER" << std::endl;
+	}
+	else if (!profiler().isRecording())
+	{
+		profiler().start();
+		std::cout << "Tracing into " << trace_path << " (T again to write it out)" << std::endl;
+	}
+	else
+	{
+		profiler().stop();
+		if (profiler().write(trace_path))
+		{
+			std::cout << "Trace of " << profiler().getCount() << " events written to " << trace_path << std::endl;
+		}
+		else std::cout << "Couldn't write " << trace_path << std::endl;
+	}
+}
+
+// A headless or benchmark frame: the world steps on by one tick on this thread, so every
+// run plays out the same. Nobody plays; the camera follows the script, if there is one.
+// ---------------------------------------------------------------------------------------
+void step_scripted(int frame)
+{
+	float dt = (float)(1.0 / tick_rate);
+	input_state.lodScale = LEVELS_OF_DETAIL && PERSPECTIVE_PROJECTION ? 1.0f : 0.0f;
+	if (frame > 0) simulate(input_state, dt);
+
+	if (!camera_script.isEmpty())
+	{
+		CameraKey key = camera_script.at(frame * dt);
+		setCameraView(world, camera, key.position, key.yaw, key.pitch);
+	}
+
+	take_snapshot(snapshot_buffer.write(), input_state, frame * dt);
+	snapshot_buffer.publish();
+}
+
+// One tick of the game, dt seconds after the last: the player's input, then everything that
+// moves by itself. Runs on the simulation thread (headless, on the main one).
+// ---------------------------------------------------------------------------------------
+void simulate(const InputSnapshot& input, float dt)
+{
+	PROFILE_ZONE("simulate");
+	static unsigned int restarts_seen = 0;
+	static unsigned int interactions_seen = 0;
+	static unsigned int mouse_moves_seen = 0;
+
+	// Restart
+	if (input.restarts != restarts_seen)
+	{
+		start();
+		restarts_seen = input.restarts;
+	}
+
+	// Look around
+	if (input.mouseMoves != mouse_moves_seen)
+	{
+		mouseMoved(world, camera, input.mouseX, input.mouseY); // update camera
+		mouse_moves_seen = input.mouseMoves;
+	}
+
+	// Double speed when "Shift" pressed
+	float cameraSpeed;
+	if (!input.run)
+		cameraSpeed = 2.5 * dt; 
+	else
+		cameraSpeed = 2.5 * dt * 2;
+	
+	// Move around
+	if (world.isAlive(camera.entity)) {
+		const glm::vec3& position = world.transform(camera.entity).position;
+		if (input.forward && 
+	    	!collisionAt(position + cameraSpeed * camera.walkFront)) {
+			moveCamera(world, camera, cameraSpeed * camera.walkFront);
+		}
+		if (input.back &&
+			!collisionAt(position - cameraSpeed * camera.walkFront)) {
+			moveCamera(world, camera, -cameraSpeed * camera.walkFront);
+		}
+		if (input.left && 
+			!collisionAt(position - camera.right * cameraSpeed)) {
+			moveCamera(world, camera, -camera.right * cameraSpeed);
+		}
+		if (input.right && 
+			!collisionAt(position + camera.right * cameraSpeed)) {
+			moveCamera(world, camera, camera.right * cameraSpeed);
+		}
+	} 
+
+	// Pick up whatever was within reach as of the last tick
+	bool interacting = input.interact || input.interactions != interactions_seen;
+	interactions_seen = input.interactions;
+	if (interacting && pickup_in_reach != NO_ENTITY && world.exists(pickup_in_reach))
+	{
+		EntityId picked = pickup_in_reach;
+		PickupKind kind = world.pickup(picked).kind;
+		world.destroy(picked);
+		pickup_in_reach = NO_ENTITY;
+	
+		if (kind == PICKUP_LIGHT) {
+			world.setVisible(tEquip, true);
+			light_source = camera.entity;
+		} else {
+			num_items_found += 1;
+			if (num_items_found == 4) {
+				ALL_ITEMS_FOUND = true;
+				world.setVisible(door, false);
+			}
+		}
+	}
+
 	// Increase brightness radius
-	if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS)
+	if (input.brighter)
 	{
-		lightSourceRadius += 0.05f;
+		lightSourceRadius += 3.0f * dt;
 		if (lightSourceRadius > 1.0f) {	
 			lightSourceRadius = 1.0f;
 		}
 	}
 
 	// Decrease brightness radius
-	if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS)
+	if (input.dimmer)
 	{
-		lightSourceRadius -= 0.05f;
+		lightSourceRadius -= 3.0f * dt;
 		if (lightSourceRadius < 0.01f) {	
 			lightSourceRadius = 0.01f;
 		}
 	}
+
+	// Everything moving by itself
+	animationSystem(world, dt);
+	chaseSystem(world, dt);
+	pickup_in_reach = pickupSystem(world, world.transform(camera.entity).position, INTERACT_DISTANCE);
+}
+
+// Copy what the renderer needs out of the world as it stands
+// ---------------------------------------------------------------------------------------
+void take_snapshot(FrameSnapshot& frame, const InputSnapshot& input, double time)
+{
+	PROFILE_ZONE("take_snapshot");
+	static unsigned int tick = 0;
+	frame.clear();
+	frame.tick = tick++;
+	frame.time = time;
+	frame.restarts = restart_count;
+	frame.cameraPos = world.transform(camera.entity).position;
+	frame.cameraFront = camera.front;
+	frame.cameraUp = camera.up;
+	frame.lightPos = world.transform(light_source).position;
+	frame.lightRadius = lightSourceRadius;
+	frame.doorOpen = !world.renderable(door).visible;
+	frame.lodScale = input.lodScale;
+	snapshotSystem(world, frame, light_source);
+
+	// The scenery's parts are only placed again when some of it changed, or all of it did
+	// on restart
+	static unsigned int baked_revision = 0;
+	if (world.getSceneryRevision() != baked_revision || !scenery_parts)
+	{
+		std::vector<StaticPart>* parts = new std::vector<StaticPart>();
+		bakeScenery(world, *parts);
+		scenery_parts = SceneryParts(parts);
+		baked_revision = world.getSceneryRevision();
+		scenery_revision++;
+	}
+	frame.scenery = scenery_parts;
+	frame.sceneryRevision = scenery_revision;
+}
+
+// The simulation thread: the world only ever steps on by a whole tick of 1 / tick_rate
+// seconds, as many as the time gone by holds, each ending in a snapshot for the renderer.
+// Every tick is the same length, so the game plays the same however fast frames are drawn;
+// the renderer blends between ticks. Neither thread waits on the other.
+// ---------------------------------------------------------------------------------------
+void simulation_loop()
+{
+	PROFILE_THREAD("simulation");
+	const double step = 1.0 / tick_rate;
+	double simulated = clockSeconds(); // how far the world has got
+
+	while (simulating)
+	{
+		double now = clockSeconds();
+		if (now - simulated > MAX_TICKS_BEHIND * step)
+		{
+			// Too far behind to catch up (e.g. stopped in a debugger): let the time go
+			simulated = now - MAX_TICKS_BEHIND * step;
+		}
+
+		while (simulated + step <= now)
+		{
+			const InputSnapshot& input = input_buffer.read();
+			simulate(input, (float)step);
+			simulated += step;
+
+			take_snapshot(snapshot_buffer.write(), input, simulated);
+			snapshot_buffer.publish();
+		}
+
+		std::this_thread::sleep_for(std::chrono::duration<double>(simulated + step - clockSeconds()));
+	}
 }
 
 // What to do when the mouse moves 
 // ---------------------------------------------------------------------------------------------
 void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 {
-	cam->mouseMoved(xpos, ypos); // update camera
-	player->setFront(glm::vec3(cam->getFront().x, 0.0, cam->getFront().z));
+	input_state.mouseX = xpos;
+	input_state.mouseY = ypos;
+	input_state.mouseMoves++;
+}
+
+// The size frames are drawn at: the window's framebuffer, or the offscreen one without a
+// window (made at the window's size, see HeadlessContext)
+// ---------------------------------------------------------------------------------------------
+void framebuffer_size(GLFWwindow* window, int& width, int& height)
+{
+	width = SCR_WIDTH;
+	height = SCR_HEIGHT;
+	if (window != NULL) glfwGetFramebufferSize(window, &width, &height);
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -645,6 +1426,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 // ----------------------------
 unsigned int loadTexture(char const * path)
 {
+	PROFILE_ZONE("loadTexture");
 	unsigned int textureID;
 	glGenTextures(1, &textureID);
 
@@ -661,7 +1443,7 @@ unsigned int loadTexture(char const * path)
 		else if (nrComponents == 4)
 			format = GL_RGBA;
 
-		glBindTexture(GL_TEXTURE_2D, textureID);
+		glState().bindTexture(0, textureID);
 		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
 		glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -681,13 +1463,17 @@ unsigned int loadTexture(char const * path)
 	return textureID;
 }
 
-// Determine if the camera is close enough to some entity to interact with it
-bool is_close_to(glm::vec3 entity_pos)
+// A faint warm point light around something glowing in the dark
+LightBlock glowLight(glm::vec3 position)
 {
-	if(glm::length(cam->getPosition() - entity_pos) <= INTERACT_DISTANCE)
-		return true;
-	else
-		return false;
+	LightBlock glow = LightBlock();
+	glow.position = position;
+	glow.diffuse = glm::vec3(0.5f, 0.35f, 0.1f);
+	glow.specular = glm::vec3(0.2f, 0.15f, 0.05f);
+	glow.constant = 1.0f;
+	glow.linear = 0.7f;
+	glow.quadratic = 1.8f;
+	return glow;
 }
 
 // Collisions
@@ -699,164 +1485,115 @@ bool collisionAt(glm::vec3 position)
 	return colX || colZ;
 }
 
-// Add an entity and construct it's model
-void addEntity(
-	Entity* e, 
-	glm::vec3 scales[], glm::vec3 positions[], int numModel,
-	unsigned int textures[], int numTextures)	
+// Add an entity that moves, with the given components besides its model
+EntityId addEntity(glm::vec3 position, int model, unsigned int components)
 {
-	e->setModel(scales, positions, numModel);
-	e->setTextures(textures, numTextures);
-	entities.push_back(e);
+	EntityId e = world.create(components, position);
+	world.setModel(e, model);
+	return e;
 }
 
-// Add a pickup and construct it's model
-void addPickup(
-	Pickup* p, 
-	glm::vec3 scales[], glm::vec3 positions[], int numModel,
-	unsigned int textures[], int numTextures)	
+// Add an entity that never moves, and bake it into the static batch
+EntityId addStatic(glm::vec3 position, int model)
 {
-	p->setModel(scales, positions, numModel);
-	p->setTextures(textures, numTextures);
-	pickups.push_back(p);
+	EntityId e = world.create(IS_STATIC, position);
+	world.setModel(e, model);
+	return e;
+}
+
+// Add a pickup, bobbing and spinning where it lies
+EntityId addPickup(glm::vec3 position, int model, PickupKind kind)
+{
+	EntityId p = addEntity(position, model, HAS_PICKUP | HAS_ANIMATION);
+	world.pickup(p).kind = kind;
+	addBob(world, p, bob_curve);
+	addSpin(world, p, spin_curve);
+	return p;
 }
 
 void start()
 {	
 	//Cleanup (in case of restart)
-	delete cam;
-	delete player;
-	delete tEquip;
-	delete table;
-	delete walls;
-	delete door;
-	delete torch;
-	delete enemy;
-
-	// Container for entities
-	entities = std::list<Entity*>();
-	pickups = std::list<Pickup*>();
+	world.clear();
+	scenery_parts.reset();
+	pickup_in_reach = NO_ENTITY;
+	restart_count++;
+
+	// Models
+	int street_model = world.addModel(street_scales, street_positions, 1, road_textures, 2);
+	int grass_model = world.addModel(grass_scales, grass_positions, 1, grass_textures, 2);
+	int table_model = world.addModel(table_scales, table_positions, 5, wood_textures, 2);
+	int wall_model = world.addModel(wall_scales, wall_positions, 6, brick_textures, 2);
+	int door_model = world.addModel(door_scales, door_positions, 1, metal_textures, 2);
+	int lantern_model = world.addModel(lantern_scales, lantern_positions, 6, marble_textures, 2);
+	world.addLod(lantern_model, lantern_far_scales, lantern_far_positions, 1, LANTERN_LOD_DISTANCE);
+	int enemy_model = world.addModel(enemy_scales, enemy_positions, 6, night_textures, 2);
+	world.addLod(enemy_model, enemy_far_scales, enemy_far_positions, 1, ENEMY_LOD_DISTANCE);
+	int pickup_model = world.addModel(pickup_scales, pickup_positions, 1, box_textures, 2);
+
+	// How pickups move, shared by all of them
+	bob_curve = addBobCurve(world);
+	spin_curve = addSpinCurve(world);
 
 	// Camera	
-	cam = new Camera(
+	camera = createCamera(world,
 		glm::vec3(0.0f, 0.9f, 3.0f), 	// Position
 		glm::vec3(0.0f, 0.0f, -1.0f),	// Front face
 		glm::vec3(0.0f, 1.0f,  0.0f),	// Up face
  		SCR_WIDTH, SCR_HEIGHT
 	);
-	entities.push_back(cam);
+	glm::vec3 cam_position = world.transform(camera.entity).position;
 
-	// Player
-	player = new Entity(
-		cam->getPosition(), 
-		cam->getFront(),
-		cam->getUp()
-	);
+	// Torch Equip, shown once the torch is picked up. It holds the light, so casts no shadow.
+	tEquip = addEntity(cam_position, lantern_model, 0);
+	world.setVisible(tEquip, false);
+	world.renderable(tEquip).castsShadow = false;
+	holdItem(world, camera, tEquip);
 
-	// Torch Equip
-	tEquip = new Entity( 
-		cam->getPosition(),
-		cam->getFront(),
-		cam->getUp()
-	);
-	tEquip->setModel(lantern_scales, lantern_positions, 6);
-	tEquip->setTextures(marble_textures, 2);
-	cam->setItem(tEquip);
-	cam->setItemVisible(false);
+	// Ground
+	addStatic(ORIGIN, street_model);
+	addStatic(ORIGIN, grass_model);
 
 	// Table
-	table = new Entity(
-		glm::vec3(19.0f, 0.45f, -18.0f), 
-		glm::vec3(0.0f, 0.0f, -1.0f),
-		glm::vec3(0.0f, 1.0f, 0.0f)
-	);
-	table->setPitch(185.0f);
-	table->setRoll(5.1f);
-	addEntity(table, table_scales, table_positions, 5, wood_textures, 2);
+	EntityId table = addStatic(glm::vec3(19.0f, 0.45f, -18.0f), table_model);
+	world.transform(table).pitch = 185.0f;
+	world.transform(table).roll = 5.1f;
 	
 	// Table 2
-	table = new Entity(
-		glm::vec3(16.0f, -0.35f, -20.0f), 
-		glm::vec3(0.0f, 0.0f, -1.0f),
-		glm::vec3(0.0f, 1.0f, 0.0f)
-	);
-	table->setPitch(356.0f);
-	table->setYaw(35.0f);
-	addEntity(table, table_scales, table_positions, 5, wood_textures, 2);
+	table = addStatic(glm::vec3(16.0f, -0.35f, -20.0f), table_model);
+	world.transform(table).pitch = 356.0f;
+	world.transform(table).yaw = 35.0f;
 
 	// Walls
-	walls = new Entity(
-		glm::vec3(0.0f, 0.0f, 0.0f), 
-		glm::vec3(0.0f, 0.0f, -1.0f),
-		glm::vec3(0.0f, 1.0f, 0.0f)
-	);
-	addEntity(walls, wall_scales, wall_positions, 6, brick_textures, 2);
+	addStatic(glm::vec3(0.0f, 0.0f, 0.0f), wall_model);
 
 	// Door
-	door = new Entity(
-		glm::vec3(0.0f, 0.0f, 0.0f), 
-		glm::vec3(0.0f, 0.0f, -1.0f),
-		glm::vec3(0.0f, 1.0f, 0.0f)
-	);
-	addEntity(door, door_scales, door_positions, 1, metal_textures, 2);
-	
-	// Torch
-	torch = new Pickup(
-		glm::vec3(cam->getPosition().x, 0.5f, cam->getPosition().z - 1),
-		glm::vec3(0.0f, 0.0f, -1.0f),	// Front face
-		glm::vec3(0.0f, 1.0f,  0.0f)	// Up face
-	);
-	addPickup(torch, lantern_scales, lantern_positions, 6, marble_textures, 2);
-	light_source = torch;
+	door = addStatic(glm::vec3(0.0f, 0.0f, 0.0f), door_model);
 
 	// Enemy
-	enemy = new Enemy(
-		glm::vec3(cam->getPosition().x, cam->getPosition().y, cam->getPosition().z - 15),
-		glm::vec3(0.0f, 0.0f, -1.0f),	// Front face
-		glm::vec3(0.0f, 1.0f,  0.0f),	// Up face
-		cam // target to pursue
-	);
-	enemy->setSpeed(0.05f);
-	float animationSpd = 10.0f;
-	enemy->setPitchAnimation(2, animationSpd);
-	enemy->setPitchAnimation(3, -animationSpd);
-	enemy->setPitchAnimation(4, animationSpd);
-	enemy->setPitchAnimation(5, -animationSpd);
-	addEntity(enemy, enemy_scales, enemy_positions, 6, night_textures, 2);
+	EntityId enemy = addEntity(
+		glm::vec3(cam_position.x, cam_position.y, cam_position.z - 15), enemy_model, HAS_CHASE);
+	world.chase(enemy).target = camera.entity;
+	world.chase(enemy).speed = 3.0f;
+	world.chase(enemy).reach = 1.0f;
+	float animationSpd = 600.0f;
+	int swing_forward = addSwingCurve(world, animationSpd);
+	int swing_back = addSwingCurve(world, -animationSpd);
+	addSwing(world, enemy, 2, swing_forward);
+	addSwing(world, enemy, 3, swing_back);
+	addSwing(world, enemy, 4, swing_forward);
+	addSwing(world, enemy, 5, swing_back);
+	
+	// Torch, the light until it's picked up
+	torch = addPickup(glm::vec3(cam_position.x, 0.5f, cam_position.z - 1), lantern_model, PICKUP_LIGHT);
+	world.renderable(torch).castsShadow = false;
+	light_source = torch;
 
 	// Goals
-
-	//1
-	goal01 = new Pickup(
- 		glm::vec3(-11.0f, 0.5f, -15.0f),
-		glm::vec3(0.0f, 0.0f, -1.0f),
-		glm::vec3(0.0f, 1.0f,  0.0f)
-	);
-	addPickup(goal01, pickup_scales, pickup_positions, 2, box_textures, 2);
-
-	//2
-	goal02 = new Pickup(
- 		glm::vec3(17.0f, 0.5f, -20.0f),
-		glm::vec3(0.0f, 0.0f, -1.0f),
-		glm::vec3(0.0f, 1.0f,  0.0f)
-	);
-	addPickup(goal02, pickup_scales, pickup_positions, 2, box_textures, 2);
-
-	//3
-	goal03 = new Pickup(
- 		glm::vec3(27.0f, 0.5f, 25.0f),
-		glm::vec3(0.0f, 0.0f, -1.0f),
-		glm::vec3(0.0f, 1.0f,  0.0f)
-	);
-	addPickup(goal03, pickup_scales, pickup_positions, 2, box_textures, 2);
-
-	//4
-	goal04 = new Pickup(
- 		glm::vec3(-30.0f, 0.5f, 27.0f),
-		glm::vec3(0.0f, 0.0f, -1.0f),
-		glm::vec3(0.0f, 1.0f,  0.0f)
-	);
-	addPickup(goal04, pickup_scales, pickup_positions, 2, box_textures, 2);
+	addPickup(glm::vec3(-11.0f, 0.5f, -15.0f), pickup_model, PICKUP_GOAL);
+	addPickup(glm::vec3(17.0f, 0.5f, -20.0f), pickup_model, PICKUP_GOAL);
+	addPickup(glm::vec3(27.0f, 0.5f, 25.0f), pickup_model, PICKUP_GOAL);
+	addPickup(glm::vec3(-30.0f, 0.5f, 27.0f), pickup_model, PICKUP_GOAL);
 
 	num_items_found = 0;
 	ALL_ITEMS_FOUND = false;
@@ -0,0 +1,31 @@
+#version 330 core
+
+// Geometry pass of deferred shading, drawn with sample2.vs. Fills the G-buffer (see
+// deferred.hpp); depth comes from the depth attachment.
+layout (location = 0) out vec4 AlbedoSpec;  // diffuse texel, and the specular map as a mask
+layout (location = 1) out vec2 PackedNormal; // octahedral, scaled into [0, 1]
+
+in vec3 FragPos;  
+in vec3 Normal;  
+in vec2 TexCoords;
+
+uniform sampler2D diffuseMap;
+uniform sampler2D specularMap;
+
+// Fold the unit sphere onto the square [-1, 1]^2
+vec2 encodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    if (n.z < 0.0)
+    {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return n.xy;
+}
+
+void main()
+{
+    vec3 specular = texture(specularMap, TexCoords).rgb;
+    AlbedoSpec = vec4(texture(diffuseMap, TexCoords).rgb, (specular.r + specular.g + specular.b) / 3.0);
+    PackedNormal = encodeNormal(normalize(Normal)) * 0.5 + 0.5;
+}
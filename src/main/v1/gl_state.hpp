@@ -0,0 +1,237 @@
+#ifndef GL_STATE_HPP
+#define GL_STATE_HPP
+
+#include <glad/glad.h>
+
+#include <map>
+
+static const int MAX_TEXTURE_UNITS = 16;
+
+// Thin layer over the OpenGL binds we use. It remembers the current program, VAO, textures,
+// buffers and a handful of capabilities, and drops calls that would not change anything.
+// All code should bind through here (see glState()), otherwise the cache goes stale; call
+// invalidate() after handing the context to anything that doesn't.
+class GLStateCache
+{
+
+private:
+
+	// Fields
+	unsigned int program;
+	unsigned int vertexArray;
+	unsigned int activeUnit;
+	unsigned int textures[MAX_TEXTURE_UNITS];
+	std::map<GLenum, unsigned int> buffers;		// generic binding point per target
+	std::map<GLenum, bool> capabilities;
+	GLenum depthFunction;
+	int depthWrites, colorWrites; // -1 while unknown
+	unsigned int screen;			// the framebuffer frames end up in
+
+	// Counters for the current frame
+	int issued, elided;
+
+	bool changed(bool differs)
+	{
+		if (differs) issued++; else elided++;
+		return differs;
+	}
+
+public:
+
+	// Constructor
+	GLStateCache()
+	{
+		invalidate();
+		issued = 0;
+		elided = 0;
+		screen = 0;
+	}
+
+	// Forget everything, so the next call of each kind always reaches GL
+	void invalidate()
+	{
+		program = ~0u;
+		vertexArray = ~0u;
+		activeUnit = ~0u;
+		for (int ii = 0; ii < MAX_TEXTURE_UNITS; ii++)
+		{
+			textures[ii] = ~0u;
+		}
+		buffers.clear();
+		capabilities.clear();
+		depthFunction = GL_NONE;
+		depthWrites = -1;
+		colorWrites = -1;
+	}
+
+	// Start a new frame's counters
+	void beginFrame()
+	{
+		issued = 0;
+		elided = 0;
+	}
+
+	int getIssued() { return issued; }
+	int getElided() { return elided; }
+
+	// Draw frames into framebuffer id instead of the window's (0), e.g. when there's no window
+	void setScreen(unsigned int id) { screen = id; }
+
+	// Go back to drawing the frame, after rendering into a framebuffer of one's own
+	void bindScreen()
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, screen);
+	}
+
+	void useProgram(unsigned int id)
+	{
+		if (changed(program != id))
+		{
+			glUseProgram(id);
+			program = id;
+		}
+	}
+
+	void bindVertexArray(unsigned int id)
+	{
+		if (changed(vertexArray != id))
+		{
+			glBindVertexArray(id);
+			vertexArray = id;
+		}
+	}
+
+	// Bind a texture to the given unit (0 for GL_TEXTURE0, ...). Only one texture per unit is
+	// remembered, so each unit should stick to one target.
+	void bindTexture(unsigned int unit, unsigned int id, GLenum target = GL_TEXTURE_2D)
+	{
+		if (changed(textures[unit] != id))
+		{
+			if (changed(activeUnit != unit))
+			{
+				glActiveTexture(GL_TEXTURE0 + unit);
+				activeUnit = unit;
+			}
+			glBindTexture(target, id);
+			textures[unit] = id;
+		}
+	}
+
+	// Make unit the one texture calls (glTexImage2D, glTexParameteri, ...) apply to. A skipped
+	// bindTexture() leaves whichever unit was last active, so call this before editing.
+	void activeTexture(unsigned int unit)
+	{
+		if (changed(activeUnit != unit))
+		{
+			glActiveTexture(GL_TEXTURE0 + unit);
+			activeUnit = unit;
+		}
+	}
+
+	// GL_ELEMENT_ARRAY_BUFFER belongs to the bound VAO, so it is passed straight through
+	void bindBuffer(GLenum target, unsigned int id)
+	{
+		if (target == GL_ELEMENT_ARRAY_BUFFER)
+		{
+			changed(true);
+			glBindBuffer(target, id);
+			return;
+		}
+
+		std::map<GLenum, unsigned int>::iterator it = buffers.find(target);
+		if (changed(it == buffers.end() || it->second != id))
+		{
+			glBindBuffer(target, id);
+			buffers[target] = id;
+		}
+	}
+
+	// Indexed binds also replace the generic binding of the target
+	void bindBufferRange(GLenum target, unsigned int index, unsigned int id, GLintptr offset, GLsizeiptr size)
+	{
+		changed(true);
+		glBindBufferRange(target, index, id, offset, size);
+		buffers[target] = id;
+	}
+
+	void enable(GLenum cap)
+	{
+		std::map<GLenum, bool>::iterator it = capabilities.find(cap);
+		if (changed(it == capabilities.end() || !it->second))
+		{
+			glEnable(cap);
+			capabilities[cap] = true;
+		}
+	}
+
+	void disable(GLenum cap)
+	{
+		std::map<GLenum, bool>::iterator it = capabilities.find(cap);
+		if (changed(it == capabilities.end() || it->second))
+		{
+			glDisable(cap);
+			capabilities[cap] = false;
+		}
+	}
+
+	void depthFunc(GLenum func)
+	{
+		if (changed(depthFunction != func))
+		{
+			glDepthFunc(func);
+			depthFunction = func;
+		}
+	}
+
+	void depthMask(bool b)
+	{
+		if (changed(depthWrites != (int)b))
+		{
+			glDepthMask(b ? GL_TRUE : GL_FALSE);
+			depthWrites = (int)b;
+		}
+	}
+
+	void colorMask(bool b)
+	{
+		if (changed(colorWrites != (int)b))
+		{
+			glColorMask(b, b, b, b);
+			colorWrites = (int)b;
+		}
+	}
+
+	// Deleted names can be handed out again, so they must not stay cached
+	void deleteVertexArray(unsigned int id)
+	{
+		if (vertexArray == id) vertexArray = ~0u;
+		glDeleteVertexArrays(1, &id);
+	}
+
+	void deleteBuffer(unsigned int id)
+	{
+		for (std::map<GLenum, unsigned int>::iterator it = buffers.begin(); it != buffers.end(); ++it)
+		{
+			if (it->second == id) it->second = ~0u;
+		}
+		glDeleteBuffers(1, &id);
+	}
+
+	void deleteTexture(unsigned int id)
+	{
+		for (int ii = 0; ii < MAX_TEXTURE_UNITS; ii++)
+		{
+			if (textures[ii] == id) textures[ii] = ~0u;
+		}
+		glDeleteTextures(1, &id);
+	}
+};
+
+// The state cache for the one GL context we render with
+inline GLStateCache& glState()
+{
+	static GLStateCache state;
+	return state;
+}
+
+#endif
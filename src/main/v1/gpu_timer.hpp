@@ -0,0 +1,77 @@
+#ifndef GPU_TIMER_HPP
+#define GPU_TIMER_HPP
+
+#include <glad/glad.h>
+
+#include "clock.hpp"
+#include "profiler.hpp"
+
+// Times a stretch of GL commands on the GPU with GL_TIME_ELAPSED queries. Two queries take
+// turns, so reading one frame's result waits on the frame before it rather than stalling
+// on the commands just issued; getMilliseconds() is therefore a frame behind. Each result
+// also goes to the profiler under the timer's name.
+class GpuTimer
+{
+
+private:
+
+	// Fields
+	const char* name;
+	unsigned int queries[2]; // created on first use
+	double issued[2];		// when each query's commands were issued
+	bool pending[2];		// ended, but not read yet
+	int frame;
+	double milliseconds;
+
+public:
+
+	// Constructor -- the queries live as long as the context
+	explicit GpuTimer(const char* inName)
+	{
+		name = inName;
+		queries[0] = 0;
+		queries[1] = 0;
+		issued[0] = 0.0;
+		issued[1] = 0.0;
+		pending[0] = false;
+		pending[1] = false;
+		frame = 0;
+		milliseconds = 0.0;
+	}
+
+	void begin()
+	{
+		if (queries[0] == 0) glGenQueries(2, queries);
+		int last = (frame + 1) % 2;
+		if (pending[last])
+		{
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(queries[last], GL_QUERY_RESULT, &elapsed);
+			milliseconds = elapsed / 1e6;
+			pending[last] = false;
+			PROFILE_GPU(name, issued[last], milliseconds);
+		}
+		issued[frame % 2] = clockSeconds();
+		glBeginQuery(GL_TIME_ELAPSED, queries[frame % 2]);
+	}
+
+	void end()
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		pending[frame % 2] = true;
+		frame++;
+	}
+
+	// Start over, e.g. after frames that weren't timed
+	void reset()
+	{
+		pending[0] = false;
+		pending[1] = false;
+		frame = 0;
+		milliseconds = 0.0;
+	}
+
+	double getMilliseconds() { return milliseconds; }
+};
+
+#endif
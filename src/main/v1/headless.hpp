@@ -0,0 +1,231 @@
+#ifndef HEADLESS_HPP
+#define HEADLESS_HPP
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#ifdef HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "gl_state.hpp"
+
+#ifdef HAVE_EGL
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#endif
+
+// An OpenGL 3.3 core context with no window, drawing into a framebuffer of its own, for
+// running unattended (build machines, containers, software rasterizers like llvmpipe). With
+// EGL it needs no display server at all: Mesa's surfaceless platform is tried first, then the
+// default display, both without a surface (EGL_KHR_surfaceless_context). Otherwise, or if
+// that fails, it falls back on a hidden GLFW window.
+class HeadlessContext
+{
+
+private:
+
+	// Fields
+	GLFWwindow* window;		// the hidden window, when not on EGL
+#ifdef HAVE_EGL
+	EGLDisplay display;
+	EGLContext context;
+#endif
+	unsigned int FBO, colorTarget, depthTarget;
+	int width, height;
+
+#ifdef HAVE_EGL
+	bool createEgl()
+	{
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+			(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay != NULL)
+		{
+			display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		}
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+		{
+			display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+			if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+			{
+				display = EGL_NO_DISPLAY;
+				return false;
+			}
+		}
+
+		const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+		if (extensions == NULL || strstr(extensions, "EGL_KHR_surfaceless_context") == NULL
+			|| !eglBindAPI(EGL_OPENGL_API))
+		{
+			return false;
+		}
+
+		EGLint configAttributes[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_NONE
+		};
+		EGLConfig config;
+		EGLint numConfigs = 0;
+		if (!eglChooseConfig(display, configAttributes, &config, 1, &numConfigs) || numConfigs == 0)
+		{
+			return false;
+		}
+
+		EGLint contextAttributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+			EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+			EGL_NONE
+		};
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+		if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+		{
+			return false;
+		}
+		return gladLoadGLLoader((GLADloadproc)eglGetProcAddress) != 0;
+	}
+#endif
+
+	bool createHiddenWindow()
+	{
+		if (!glfwInit()) return false;
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+		window = glfwCreateWindow(width, height, "headless", NULL, NULL);
+		if (window == NULL) return false;
+		glfwMakeContextCurrent(window);
+		return gladLoadGLLoader((GLADloadproc)glfwGetProcAddress) != 0;
+	}
+
+public:
+
+	HeadlessContext(const HeadlessContext&) = delete;
+	HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+	// Constructor -- nothing is created until create()
+	HeadlessContext()
+	{
+		window = NULL;
+#ifdef HAVE_EGL
+		display = EGL_NO_DISPLAY;
+		context = EGL_NO_CONTEXT;
+#endif
+		FBO = 0;
+		colorTarget = 0;
+		depthTarget = 0;
+		width = 0;
+		height = 0;
+	}
+
+	~HeadlessContext()
+	{
+		if (FBO != 0)
+		{
+			glDeleteFramebuffers(1, &FBO);
+			glDeleteRenderbuffers(1, &colorTarget);
+			glDeleteRenderbuffers(1, &depthTarget);
+		}
+#ifdef HAVE_EGL
+		if (display != EGL_NO_DISPLAY)
+		{
+			eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			if (context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+			eglTerminate(display);
+		}
+#endif
+		if (window != NULL) glfwTerminate();
+	}
+
+	// Make a context current and load GL, then a width x height framebuffer every frame is
+	// drawn into (see GLStateCache::setScreen). False if no context could be had.
+	bool create(int inWidth, int inHeight)
+	{
+		width = inWidth;
+		height = inHeight;
+
+		bool created = false;
+#ifdef HAVE_EGL
+		created = createEgl();
+		if (!created) std::cout << "No surfaceless EGL context, trying a hidden window" << std::endl;
+#endif
+		if (!created) created = createHiddenWindow();
+		if (!created) return false;
+
+		glGenFramebuffers(1, &FBO);
+		glGenRenderbuffers(1, &colorTarget);
+		glGenRenderbuffers(1, &depthTarget);
+		glBindRenderbuffer(GL_RENDERBUFFER, colorTarget);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, depthTarget);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorTarget);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthTarget);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "Offscreen framebuffer is incomplete" << std::endl;
+			return false;
+		}
+		glState().setScreen(FBO);
+		glViewport(0, 0, width, height);
+		return true;
+	}
+
+	int getWidth() { return width; }
+	int getHeight() { return height; }
+
+	// Write what was last drawn to path, as a binary PPM
+	bool savePpm(const char* path)
+	{
+		std::vector<unsigned char> pixels(width * height * 3);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+
+		FILE* file = fopen(path, "wb");
+		if (file == NULL) return false;
+		fprintf(file, "P6\n%d %d\n255\n", width, height);
+		for (int row = height - 1; row >= 0; row--) // GL's rows run bottom up
+		{
+			fwrite(&pixels[row * width * 3], 1, width * 3, file);
+		}
+		fclose(file);
+		return true;
+	}
+};
+
+// Summary of a headless run's frame times, in seconds. The first frame is reported on its
+// own, as it pays for baking the scenery and warming up the driver.
+inline void printHeadlessTimings(std::vector<double> frameTimes, std::ostream& out)
+{
+	if (frameTimes.empty()) return;
+	out << std::fixed << std::setprecision(3);
+	out << "Headless: " << frameTimes.size() << " frames, first " << frameTimes[0] * 1e3 << " ms";
+	frameTimes.erase(frameTimes.begin());
+	if (!frameTimes.empty())
+	{
+		double total = 0.0;
+		for (size_t ii = 0; ii < frameTimes.size(); ii++) total += frameTimes[ii];
+		double mean = total / frameTimes.size();
+		out << ", then mean " << mean * 1e3 << " ms (" << 1.0 / mean << " fps), min "
+			<< *std::min_element(frameTimes.begin(), frameTimes.end()) * 1e3 << " ms, max "
+			<< *std::max_element(frameTimes.begin(), frameTimes.end()) * 1e3 << " ms";
+	}
+	out << std::endl;
+}
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef LIGHT_BENCH_HPP
+#define LIGHT_BENCH_HPP
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/shader_m.h>
+
+#include <stdlib.h>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "clock.hpp"
+#include "clusters.hpp"
+#include "gl_state.hpp"
+#include "render_queue.hpp"
+#include "uniform_blocks.hpp"
+
+static const int LIGHT_BENCH_FRAMES = 20;	// frames timed per light count
+static const int LIGHT_BENCH_MAX = 1024;
+static const float LIGHT_BENCH_AREA = 64.0f;	// the scene is a square this wide
+
+// count point lights scattered over the benchmark scene, the same ones on every run
+inline std::vector<LightBlock> benchLights(int count)
+{
+	srand(1234);
+	std::vector<LightBlock> lights(count);
+	for (int ii = 0; ii < count; ii++)
+	{
+		LightBlock& l = lights[ii];
+		l = LightBlock();
+		l.position = glm::vec3(
+			(rand() / (float)RAND_MAX - 0.5f) * LIGHT_BENCH_AREA,
+			0.25f + rand() / (float)RAND_MAX * 0.75f,
+			(rand() / (float)RAND_MAX - 0.5f) * LIGHT_BENCH_AREA
+		);
+		l.diffuse = glm::vec3(rand(), rand(), rand()) / (float)RAND_MAX;
+		l.specular = l.diffuse * 0.5f;
+		l.constant = 1.0f;
+		l.linear = 2.0f;
+		l.quadratic = 20.0f;
+	}
+	return lights;
+}
+
+// Frame time and cluster build time (SSE and scalar) for 1, 2, 4, ... LIGHT_BENCH_MAX point
+// lights over a floor of boxes, drawn with shader into a width x height framebuffer (run with
+// --light-bench). Frames are timed up to glFinish, so the GPU's share is included; each row's
+// last one is shown in window, if there is one.
+inline void runLightBenchmark(GLFWwindow* window, int width, int height, Shader& shader, unsigned int VAO_box,
+	unsigned int VBO_instance, unsigned int *textures, UniformBlocks& blocks,
+	const glm::mat4& projection, float nearPlane, float farPlane)
+{
+	// A floor of tiles, with a pillar on every fifth
+	std::vector<InstanceData> instances(MAX_INSTANCES);
+	float tile = LIGHT_BENCH_AREA / 16.0f;
+	for (int ii = 0; ii < MAX_INSTANCES; ii++)
+	{
+		float boxHeight = ii % 5 == 0 ? 4.0f : 0.5f;
+		glm::mat4 model = glm::translate(glm::mat4(),
+			glm::vec3((ii % 16 - 7.5f) * tile, boxHeight / 2.0f - 0.5f, (ii / 16 - 7.5f) * tile));
+		model = glm::scale(model, glm::vec3(ii % 5 == 0 ? 1.0f : tile, boxHeight, ii % 5 == 0 ? 1.0f : tile));
+		instances[ii].model = model;
+		instances[ii].normal = normalMatrix(model);
+	}
+
+	glViewport(0, 0, width, height);
+
+	glm::vec3 eye(0.0f, 20.0f, LIGHT_BENCH_AREA * 0.6f);
+	blocks.camera.view = glm::lookAt(eye, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	blocks.camera.projection = projection;
+	blocks.camera.viewPos = eye;
+
+	// Just enough of the main light to make out the scene
+	blocks.light = LightBlock();
+	blocks.light.position = eye;
+	blocks.light.ambient = glm::vec3(0.05f, 0.05f, 0.05f);
+	blocks.light.constant = 1.0f;
+	blocks.material.shininess = 32.0f;
+
+	ClusterGrid grid;
+	grid.setProjection(projection, nearPlane, farPlane, width, height);
+
+	std::cout << "Clustered lighting, " << LIGHT_BENCH_FRAMES << " frames per row (ms per frame)"
+		<< std::endl;
+	std::cout << std::setw(8) << "lights" << std::setw(12) << "in clusters"
+		<< std::setw(12) << "build SSE" << std::setw(14) << "build scalar"
+		<< std::setw(10) << "frame" << std::endl;
+
+	for (int count = 1; count <= LIGHT_BENCH_MAX; count *= 2)
+	{
+		std::vector<LightBlock> lights = benchLights(count);
+		double simdTime = 0.0, scalarTime = 0.0, frameTime = 0.0;
+
+		for (int ff = 0; ff <= LIGHT_BENCH_FRAMES; ff++)
+		{
+			double start = clockSeconds();
+
+			grid.setSimd(false);
+			grid.build(lights, blocks.camera.view);
+			double scalar = grid.getBuildTime();
+			grid.setSimd(true);
+			grid.build(lights, blocks.camera.view);
+			double simd = grid.getBuildTime();
+
+			grid.upload();
+			blocks.clusters = grid.getBlock();
+			blocks.upload();
+
+			glState().bindBuffer(GL_ARRAY_BUFFER, VBO_instance);
+			glBufferData(GL_ARRAY_BUFFER, MAX_INSTANCES * sizeof(InstanceData), &instances[0], GL_STREAM_DRAW);
+
+			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glState().useProgram(shader.ID);
+			shader.setBool("instanced", true);
+			glState().bindVertexArray(VAO_box);
+			glState().bindTexture(0, textures[0]);
+			glState().bindTexture(1, textures[1]);
+			glDrawElementsInstanced(GL_TRIANGLES, BOX_INDICES, GL_UNSIGNED_INT, (void*)0, MAX_INSTANCES);
+			glFinish();
+
+			// The first frame warms up, and isn't counted
+			if (ff == 0) continue;
+			frameTime += clockSeconds() - start - scalar;
+			simdTime += simd;
+			scalarTime += scalar;
+		}
+
+		std::cout << std::fixed << std::setprecision(3)
+			<< std::setw(8) << count << std::setw(12) << grid.getNumReferences()
+			<< std::setw(12) << simdTime * 1e3 / LIGHT_BENCH_FRAMES
+			<< std::setw(14) << scalarTime * 1e3 / LIGHT_BENCH_FRAMES
+			<< std::setw(10) << frameTime * 1e3 / LIGHT_BENCH_FRAMES << std::endl;
+		if (window != NULL) glfwSwapBuffers(window);
+	}
+
+	blocks.clusters = ClusterBlock();
+	shader.setBool("instanced", false);
+}
+
+#endif
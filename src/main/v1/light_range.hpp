@@ -0,0 +1,37 @@
+#ifndef LIGHT_RANGE_HPP
+#define LIGHT_RANGE_HPP
+
+#include <glm/glm.hpp>
+
+#include <math.h>
+
+#include "uniform_blocks.hpp"
+
+// Half of one step of an 8-bit colour channel; anything dimmer is written as 0
+static const float LIGHT_CUTOFF = 0.5f / 255.0f;
+
+// Distance past which the light (as lit by sample2.fs) can no longer brighten a pixel, or a
+// negative number if it reaches everywhere. Every term is scaled by the attenuation
+// 1 / (C + L*d + Q*d^2) and by texels of at most 1, so a fragment is no brighter than
+// (ambient + diffuse + specular) * attenuation. Solving for where that hits LIGHT_CUTOFF
+// gives C + L*d + Q*d^2 = 1 / minAttenuation.
+inline float lightRange(const LightBlock& light)
+{
+	glm::vec3 peak = light.ambient + light.diffuse + light.specular;
+	float brightest = glm::max(peak.x, glm::max(peak.y, peak.z));
+	if (brightest <= 0.0f) return 0.0f;
+
+	float target = brightest / LIGHT_CUTOFF; // 1 / minimum visible attenuation
+	float c = light.constant - target;
+	if (c >= 0.0f) return 0.0f; // too dim to show even up close
+
+	if (light.quadratic > 0.0f)
+	{
+		float discriminant = light.linear * light.linear - 4.0f * light.quadratic * c;
+		return (-light.linear + sqrtf(discriminant)) / (2.0f * light.quadratic);
+	}
+	if (light.linear > 0.0f) return -c / light.linear;
+	return -1.0f;
+}
+
+#endif
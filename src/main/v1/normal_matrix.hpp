@@ -0,0 +1,35 @@
+#ifndef NORMAL_MATRIX_HPP
+#define NORMAL_MATRIX_HPP
+
+#include <glm/glm.hpp>
+
+#include <math.h>
+
+// The matrix that takes object-space normals to world space: transpose(inverse(mat3(model))).
+// Everything we build is translate/rotate/scale, which leaves the basis columns orthogonal.
+// For M = R * S the answer is R * S^-1 = M * S^-2, i.e. each column divided by its squared
+// length, so the full inverse is only needed for sheared matrices.
+inline glm::mat3 normalMatrix(const glm::mat4& model)
+{
+	glm::mat3 m = glm::mat3(model);
+	float len0 = glm::dot(m[0], m[0]);
+	float len1 = glm::dot(m[1], m[1]);
+	float len2 = glm::dot(m[2], m[2]);
+
+	// Orthogonal columns (rigid, uniform or axis-aligned scale)
+	const float epsilon = 1e-4f;
+	float d01 = glm::dot(m[0], m[1]);
+	float d02 = glm::dot(m[0], m[2]);
+	float d12 = glm::dot(m[1], m[2]);
+	if (len0 > 0.0f && len1 > 0.0f && len2 > 0.0f
+		&& d01 * d01 <= epsilon * epsilon * len0 * len1
+		&& d02 * d02 <= epsilon * epsilon * len0 * len2
+		&& d12 * d12 <= epsilon * epsilon * len1 * len2)
+	{
+		return glm::mat3(m[0] / len0, m[1] / len1, m[2] / len2);
+	}
+
+	return glm::transpose(glm::inverse(m));
+}
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef PRIMITIVE_MESH_HPP
+#define PRIMITIVE_MESH_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <vector>
+
+#include "gl_state.hpp"
+#include "render_queue.hpp"
+
+static const int VERTEX_FLOATS = 8; // position, normal, texture coords (the layout of box[])
+
+// Vertex as the GPU reads it: 20 bytes instead of 32. The normal is packed as signed
+// normalised 10:10:10:2 (GL_INT_2_10_10_10_REV), and the texture coords are half floats.
+struct PackedVertex
+{
+	float position[3];
+	GLuint normal;
+	GLushort texCoords[2];
+};
+
+inline PackedVertex packVertex(glm::vec3 position, glm::vec3 normal, glm::vec2 texCoords)
+{
+	PackedVertex v;
+	v.position[0] = position.x;
+	v.position[1] = position.y;
+	v.position[2] = position.z;
+	v.normal = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+	v.texCoords[0] = glm::packHalf1x16(texCoords.x);
+	v.texCoords[1] = glm::packHalf1x16(texCoords.y);
+	return v;
+}
+
+// Point the bound VAO's vertex attributes (locations 0-2) at PackedVertex data in VBO
+inline void attachPackedAttributes(unsigned int VBO)
+{
+	glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
+
+	//vertex coordinates
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)0);
+	glEnableVertexAttribArray(0);
+	//normal vectors
+	glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex),
+		(void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+	//texture coordinates
+	glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex),
+		(void*)(3 * sizeof(float) + sizeof(GLuint)));
+	glEnableVertexAttribArray(2);
+}
+
+// A small built-in shape (e.g. the box), indexed and packed. The interleaved float vertices
+// it's made from are welded so each unique one is stored once, and are kept for the CPU
+// side (the static batch bakes copies of them).
+class PrimitiveMesh
+{
+
+private:
+
+	// Fields
+	std::vector<float> vertices;		// unique vertices, VERTEX_FLOATS each
+	std::vector<unsigned int> indices;	// triangles, indexing vertices
+	unsigned int VAO, VBO, EBO;
+
+public:
+
+	PrimitiveMesh(const PrimitiveMesh&) = delete;
+	PrimitiveMesh& operator=(const PrimitiveMesh&) = delete;
+
+	// Constructor -- interleaved holds numVertices vertices of VERTEX_FLOATS floats. Instance
+	// attributes are read from VBO_instance (see attachInstanceAttributes()).
+	PrimitiveMesh(const float *interleaved, int numVertices, unsigned int VBO_instance)
+	{
+		for (int ii = 0; ii < numVertices; ii++)
+		{
+			const float* v = interleaved + ii * VERTEX_FLOATS;
+			int found = -1;
+			for (size_t jj = 0; jj < vertices.size() && found < 0; jj += VERTEX_FLOATS)
+			{
+				bool same = true;
+				for (int kk = 0; kk < VERTEX_FLOATS; kk++)
+				{
+					same = same && vertices[jj + kk] == v[kk];
+				}
+				if (same) found = (int)(jj / VERTEX_FLOATS);
+			}
+			if (found < 0)
+			{
+				found = (int)(vertices.size() / VERTEX_FLOATS);
+				vertices.insert(vertices.end(), v, v + VERTEX_FLOATS);
+			}
+			indices.push_back((unsigned int)found);
+		}
+
+		std::vector<PackedVertex> packed;
+		for (size_t ii = 0; ii < vertices.size(); ii += VERTEX_FLOATS)
+		{
+			const float* v = &vertices[ii];
+			packed.push_back(packVertex(
+				glm::vec3(v[0], v[1], v[2]), glm::vec3(v[3], v[4], v[5]), glm::vec2(v[6], v[7])
+			));
+		}
+
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glGenBuffers(1, &EBO);
+
+		glState().bindVertexArray(VAO);
+		glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedVertex), &packed[0], GL_STATIC_DRAW);
+		glState().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0],
+			GL_STATIC_DRAW);
+
+		attachPackedAttributes(VBO);
+		attachInstanceAttributes(VBO_instance);
+		glState().bindVertexArray(0);
+	}
+
+	~PrimitiveMesh()
+	{
+		glState().deleteVertexArray(VAO);
+		glState().deleteBuffer(VBO);
+		glState().deleteBuffer(EBO);
+	}
+
+	unsigned int getVAO() { return VAO; }
+	unsigned int getVBO() { return VBO; }
+	int getNumVertices() { return (int)(vertices.size() / VERTEX_FLOATS); }
+	int getNumIndices() { return (int)indices.size(); }
+	const std::vector<float>& getVertices() { return vertices; }
+	const std::vector<unsigned int>& getIndices() { return indices; }
+};
+
+#endif
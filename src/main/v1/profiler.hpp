@@ -0,0 +1,198 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "clock.hpp"
+
+// Zones of CPU time on every thread, and GPU passes, recorded while a capture runs and
+// written out as a Chrome trace (open it in chrome://tracing or Perfetto). Zones only exist
+// in builds with ENABLE_PROFILER (cmake -DENABLE_PROFILER=ON); otherwise the macros below
+// compile to nothing and no capture can be started.
+#ifdef ENABLE_PROFILER
+static const bool PROFILER_BUILT = true;
+#else
+static const bool PROFILER_BUILT = false;
+#endif
+
+static const size_t PROFILER_MAX_EVENTS = 1 << 20;	// a capture stops growing past this
+static const int PROFILER_GPU_THREAD = 0;			// the GPU's row in the trace
+
+// One finished zone, in seconds on clockSeconds()
+struct ProfileEvent
+{
+	const char* name;	// a string literal, as are all names handed to the profiler
+	int thread;
+	double start, duration;
+};
+
+class Profiler
+{
+
+private:
+
+	// Fields
+	std::mutex mutex;
+	std::vector<ProfileEvent> events;
+	std::vector<std::string> threadNames;	// by thread number
+	std::atomic<bool> recording;
+	double origin;		// when the capture started
+	int dropped;		// events past PROFILER_MAX_EVENTS
+
+	void add(const char* name, int thread, double start, double duration)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (start < origin) return;
+		if (events.size() >= PROFILER_MAX_EVENTS)
+		{
+			dropped++;
+			return;
+		}
+		ProfileEvent event = { name, thread, start, duration };
+		events.push_back(event);
+	}
+
+public:
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	// Constructor -- not recording until start()
+	Profiler() : recording(false)
+	{
+		origin = 0.0;
+		dropped = 0;
+		threadNames.push_back("GPU");
+	}
+
+	// The calling thread's row in the trace, numbered on first use
+	int thread()
+	{
+		static thread_local int number = -1;
+		if (number < 0)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			number = (int)threadNames.size();
+			threadNames.push_back("thread " + std::to_string(number));
+		}
+		return number;
+	}
+
+	// Label the calling thread's row
+	void nameThread(const char* name)
+	{
+		int number = thread();
+		std::lock_guard<std::mutex> lock(mutex);
+		threadNames[number] = name;
+	}
+
+	// Throw away what was recorded and record from now on
+	void start()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		events.clear();
+		dropped = 0;
+		origin = clockSeconds();
+		recording = true;
+	}
+
+	void stop() { recording = false; }
+	bool isRecording() { return recording; }
+
+	// A CPU zone on the calling thread
+	void addZone(const char* name, double start, double end)
+	{
+		if (recording) add(name, thread(), start, end - start);
+	}
+
+	// A GPU pass, placed at the time its commands were issued (its actual start isn't known)
+	void addGpu(const char* name, double issued, double milliseconds)
+	{
+		if (recording) add(name, PROFILER_GPU_THREAD, issued, milliseconds / 1e3);
+	}
+
+	int getCount()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return (int)events.size();
+	}
+
+	// Write what was recorded to path as trace-event JSON; false if it can't be written
+	bool write(const std::string& path)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::ofstream out(path.c_str());
+		out << "{\"displayTimeUnit\": \"ms\", \"droppedEvents\": " << dropped << ", \"traceEvents\": [\n";
+		for (size_t ii = 0; ii < threadNames.size(); ii++)
+		{
+			out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << ii
+				<< ", \"args\": {\"name\": \"" << threadNames[ii] << "\"}},\n";
+		}
+		out.precision(3);
+		out << std::fixed;
+		for (size_t ii = 0; ii < events.size(); ii++)
+		{
+			const ProfileEvent& event = events[ii];
+			out << "{\"name\": \"" << event.name << "\", \"cat\": \""
+				<< (event.thread == PROFILER_GPU_THREAD ? "gpu" : "cpu")
+				<< "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << event.thread
+				<< ", \"ts\": " << (event.start - origin) * 1e6
+				<< ", \"dur\": " << event.duration * 1e6 << "},\n";
+		}
+		out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"Escape Game\"}}\n";
+		out << "]}\n";
+		return (bool)out;
+	}
+};
+
+inline Profiler& profiler()
+{
+	static Profiler instance;
+	return instance;
+}
+
+// Records the time from its construction to the end of its scope as a zone
+class ProfileZone
+{
+
+private:
+
+	// Fields
+	const char* name;
+	double start;	// negative when no capture was running
+
+public:
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+
+	// Constructor
+	explicit ProfileZone(const char* inName)
+	{
+		name = inName;
+		start = profiler().isRecording() ? clockSeconds() : -1.0;
+	}
+
+	~ProfileZone()
+	{
+		if (start >= 0.0) profiler().addZone(name, start, clockSeconds());
+	}
+};
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#define PROFILE_THREAD(name) profiler().nameThread(name)
+#define PROFILE_GPU(name, issued, milliseconds) profiler().addGpu(name, issued, milliseconds)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_THREAD(name)
+#define PROFILE_GPU(name, issued, milliseconds)
+#endif
+
+#endif
@@ -0,0 +1,572 @@
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+#include "cells.hpp"
+#include "frame_stats.hpp"
+#include "frustum.hpp"
+#include "gl_state.hpp"
+#include "normal_matrix.hpp"
+#include "profiler.hpp"
+
+static const int BOX_INDICES = 36; // the box mesh is 12 indexed triangles
+static const int MAX_INSTANCES = 256; // capacity of the per-instance buffer
+
+// Per-instance vertex data: the model matrix (locations 3-6) and its normal matrix (7-9)
+struct InstanceData
+{
+	glm::mat4 model;
+	glm::mat3 normal;
+};
+
+// Point the bound VAO's instance attributes at VBO_instance
+inline void attachInstanceAttributes(unsigned int VBO_instance)
+{
+	glState().bindBuffer(GL_ARRAY_BUFFER, VBO_instance);
+	for (int ii = 0; ii < 4; ii++)
+	{
+		glVertexAttribPointer(3 + ii, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+			(void*)(ii * sizeof(glm::vec4)));
+		glEnableVertexAttribArray(3 + ii);
+		glVertexAttribDivisor(3 + ii, 1);
+	}
+	for (int ii = 0; ii < 3; ii++)
+	{
+		glVertexAttribPointer(7 + ii, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+			(void*)(sizeof(glm::mat4) + ii * sizeof(glm::vec3)));
+		glEnableVertexAttribArray(7 + ii);
+		glVertexAttribDivisor(7 + ii, 1);
+	}
+}
+
+// One command of a glMultiDrawElementsIndirect call, laid out as GL reads it
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance; // index of the first instance's data in VBO_instance
+};
+
+// A single draw, along with all the state it needs: count indices of VAO's element buffer
+// starting at first (the whole box mesh for entity parts).
+struct DrawItem
+{
+	uint64_t key;
+	Shader* shader;
+	unsigned int VAO;
+	unsigned int textures[2];
+	int numTextures;
+	glm::mat4 model;
+	glm::mat3 normal;
+	int first, count;
+};
+
+// Collects draw items from every source during a frame, then sorts them by state and
+// submits them with as few binds as possible. Consecutive items sharing the same shader,
+// VAO and textures are drawn as one instanced call when instancing is enabled.
+// With indirect drawing (OpenGL 4.3) the per-instance data of the whole frame goes up in one
+// upload along with a command buffer, and each material is drawn by a single
+// glMultiDrawElementsIndirect, however many parts it has.
+class RenderQueue
+{
+
+private:
+
+	// Items [begin, end) drawn by one multi-draw, using numCommands commands from firstCommand
+	struct IndirectGroup
+	{
+		size_t begin, end;
+		int firstCommand, numCommands;
+	};
+
+	// Fields
+	std::vector<DrawItem> items;
+	std::vector<InstanceData> instances;
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<IndirectGroup> groups;
+	unsigned int VBO_instance;
+	unsigned int indirectBuffer; // created on first use
+	glm::vec3 viewPos;
+	float maxDepth;
+	bool instancing;
+	bool indirect;
+	bool frontToBack;
+	Shader* depthShader;		// draws the depth pre-pass; NULL while it's off
+	Shader* shadingShader;		// replaces every item's shader in the shading pass, if set
+	bool countOverdraw;
+	unsigned int overdrawQueries[2];	// GL_SAMPLES_PASSED, alternating frames
+	int overdrawFrame;
+	Frustum frustum;
+	const CellGraph* cells;
+	bool frustumCulling, cellCulling, lightCulling;	// each can be turned off on its own
+	std::vector<glm::vec4> lightRanges; // position and reach of each light
+	bool lightEverywhere; // some light has no limit on its reach
+	int entitiesCulled, partsCulled, unlitCulled;
+	int lodPartsSaved;
+
+	// Key layout, most significant first:
+	// shader (8 bits) | VAO (8 bits) | texture 0 (12 bits) | texture 1 (12 bits) | depth (24 bits)
+	// or, sorting front to back, the depth moves to the top and the rest shifts down.
+	// GL names wider than their field still sort correctly within a run, since flush()
+	// compares the real state rather than the key.
+	uint64_t makeKey(const DrawItem& item, float depth)
+	{
+		uint64_t depthBits = (uint64_t)(glm::clamp(depth / maxDepth, 0.0f, 1.0f) * 0xFFFFFF);
+		uint64_t tex0 = item.numTextures > 0 ? item.textures[0] : 0;
+		uint64_t tex1 = item.numTextures > 1 ? item.textures[1] : 0;
+
+		uint64_t state = ((uint64_t)(item.shader->ID & 0xFF) << 32)
+			| ((uint64_t)(item.VAO & 0xFF) << 24)
+			| ((tex0 & 0xFFF) << 12)
+			| (tex1 & 0xFFF);
+
+		if (frontToBack) return (depthBits << 40) | state;
+		return (state << 24) | depthBits;
+	}
+
+	static bool byKey(const DrawItem& a, const DrawItem& b)
+	{
+		return a.key < b.key;
+	}
+
+	// Same shader, VAO and textures
+	static bool sameMaterial(const DrawItem& a, const DrawItem& b)
+	{
+		if (a.shader != b.shader || a.VAO != b.VAO || a.numTextures != b.numTextures) return false;
+		for (int ii = 0; ii < a.numTextures; ii++)
+		{
+			if (a.textures[ii] != b.textures[ii]) return false;
+		}
+		return true;
+	}
+
+	static bool sameState(const DrawItem& a, const DrawItem& b)
+	{
+		return sameMaterial(a, b) && a.first == b.first && a.count == b.count;
+	}
+
+	// Upload the instance data of every sorted item, and one command per run of items
+	// sharing state, grouped by material
+	void prepareIndirect()
+	{
+		instances.resize(items.size());
+		commands.clear();
+		groups.clear();
+
+		size_t ii = 0;
+		while (ii < items.size())
+		{
+			IndirectGroup group;
+			group.begin = ii;
+			group.firstCommand = (int)commands.size();
+			while (ii < items.size() && sameMaterial(items[ii], items[group.begin]))
+			{
+				DrawElementsIndirectCommand command;
+				command.count = items[ii].count;
+				command.instanceCount = 0;
+				command.firstIndex = items[ii].first;
+				command.baseVertex = 0;
+				command.baseInstance = (GLuint)ii;
+				do
+				{
+					instances[ii].model = items[ii].model;
+					instances[ii].normal = items[ii].normal;
+					command.instanceCount++;
+					ii++;
+				} while (ii < items.size() && sameState(items[ii], items[command.baseInstance]));
+				commands.push_back(command);
+			}
+			group.end = ii;
+			group.numCommands = (int)commands.size() - group.firstCommand;
+			groups.push_back(group);
+		}
+		if (groups.empty()) return;
+
+		if (indirectBuffer == 0) glGenBuffers(1, &indirectBuffer);
+
+		glState().bindBuffer(GL_ARRAY_BUFFER, VBO_instance);
+		glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(InstanceData), &instances[0], GL_STREAM_DRAW);
+		glState().bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand),
+			&commands[0], GL_STREAM_DRAW);
+	}
+
+	void push(Shader& shader, unsigned int VAO, unsigned int *textures, int numTextures,
+		const glm::mat4& model, int first, int count, float depth)
+	{
+		DrawItem item;
+		item.shader = &shader;
+		item.VAO = VAO;
+		item.numTextures = std::min(numTextures, 2);
+		for (int ii = 0; ii < item.numTextures; ii++)
+		{
+			item.textures[ii] = textures[ii];
+		}
+		item.model = model;
+		item.normal = normalMatrix(model);
+		item.first = first;
+		item.count = count;
+		item.key = makeKey(item, depth);
+		items.push_back(item);
+	}
+
+	// Draw the sorted items once with their own shaders, or with replacement if it isn't
+	// NULL; without textures only depth is of interest
+	void drawPass(FrameStats& stats, Shader* replacement, bool textured, bool useIndirect,
+		int& bindsIssued, int& naiveBinds)
+	{
+		size_t nextGroup = 0;
+
+		Shader* currShader = NULL;
+		Uniform<glm::mat4> modelUniform;
+		Uniform<glm::mat3> normalUniform;
+		Uniform<int> instancedUniform;
+		unsigned int currVAO = 0;
+		unsigned int currTextures[] = {0, 0};
+
+		size_t ii = 0;
+		while (ii < items.size())
+		{
+			DrawItem& item = items[ii];
+
+			Shader* shader = replacement != NULL ? replacement : item.shader;
+			int numTextures = textured ? item.numTextures : 0;
+
+			// Drawing items one by one would bind the VAO and every texture for each
+			naiveBinds += 1 + numTextures;
+
+			if (shader != currShader)
+			{
+				glState().useProgram(shader->ID);
+				currShader = shader;
+				modelUniform = currShader->uniform<glm::mat4>("model");
+				normalUniform = currShader->uniform<glm::mat3>("normalMatrix");
+				instancedUniform = currShader->uniform<int>("instanced");
+				bindsIssued++;
+				naiveBinds++;
+			}
+			if (item.VAO != currVAO)
+			{
+				glState().bindVertexArray(item.VAO);
+				currVAO = item.VAO;
+				bindsIssued++;
+			}
+			for (int tt = 0; tt < numTextures; tt++)
+			{
+				if (item.textures[tt] != currTextures[tt])
+				{
+					glState().bindTexture(tt, item.textures[tt]);
+					currTextures[tt] = item.textures[tt];
+					bindsIssued++;
+				}
+			}
+
+			// A material's items all go in one multi-draw
+			if (useIndirect && nextGroup < groups.size() && groups[nextGroup].begin == ii)
+			{
+				IndirectGroup& group = groups[nextGroup++];
+				naiveBinds += (int)(group.end - ii - 1) * (1 + numTextures);
+
+				currShader->set(instancedUniform, 1);
+				glState().bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+				glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+					(void*)(group.firstCommand * sizeof(DrawElementsIndirectCommand)), group.numCommands, 0);
+				stats.drawCalls++;
+
+				ii = group.end;
+				continue;
+			}
+
+			// Gather the run of items sharing this state
+			size_t end = ii + 1;
+			while (end < items.size() && (int)(end - ii) < MAX_INSTANCES && sameState(items[end], item))
+			{
+				naiveBinds += 1 + numTextures;
+				end++;
+			}
+			int count = (int)(end - ii);
+
+			// Indirect mode already filled VBO_instance for the frame, so leave it alone
+			if (instancing && !useIndirect && count > 1)
+			{
+				instances.resize(count);
+				for (int jj = 0; jj < count; jj++)
+				{
+					instances[jj].model = items[ii + jj].model;
+					instances[jj].normal = items[ii + jj].normal;
+				}
+
+				// Orphan the previous contents so we don't wait on the last draw
+				glState().bindBuffer(GL_ARRAY_BUFFER, VBO_instance);
+				glBufferData(GL_ARRAY_BUFFER, MAX_INSTANCES * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+				glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceData), &instances[0]);
+
+				currShader->set(instancedUniform, 1);
+				glDrawElementsInstanced(GL_TRIANGLES, item.count, GL_UNSIGNED_INT,
+					(void*)(item.first * sizeof(unsigned int)), count);
+				stats.drawCalls++;
+			}
+			else
+			{
+				currShader->set(instancedUniform, 0);
+				for (size_t jj = ii; jj < end; jj++)
+				{
+					currShader->set(modelUniform, items[jj].model);
+					currShader->set(normalUniform, items[jj].normal);
+					glDrawElements(GL_TRIANGLES, item.count, GL_UNSIGNED_INT,
+						(void*)(item.first * sizeof(unsigned int)));
+					stats.drawCalls++;
+				}
+			}
+
+			ii = end;
+		}
+	}
+
+public:
+
+	// Constructor -- VBO_instance must be attached to every VAO whose items may be instanced
+	RenderQueue(unsigned int inVBO_instance, float inMaxDepth)
+	{
+		VBO_instance = inVBO_instance;
+		maxDepth = inMaxDepth;
+		instancing = true;
+		indirect = true;
+		frontToBack = false;
+		depthShader = NULL;
+		shadingShader = NULL;
+		countOverdraw = false;
+		overdrawQueries[0] = 0;
+		overdrawQueries[1] = 0;
+		overdrawFrame = 0;
+		indirectBuffer = 0;
+		frustumCulling = true;
+		cellCulling = true;
+		lightCulling = true;
+		cells = NULL;
+		lightEverywhere = true;
+		entitiesCulled = 0;
+		partsCulled = 0;
+		unlitCulled = 0;
+		lodPartsSaved = 0;
+		viewPos = glm::vec3(0.0f, 0.0f, 0.0f);
+	}
+
+	void setInstancing(bool b) { instancing = b; }
+	void setIndirect(bool b) { indirect = b; }
+
+	// Sort purely by distance, nearest first, so hidden fragments fail the depth test early
+	// (at the cost of more state changes)
+	void setFrontToBack(bool b) { frontToBack = b; }
+
+	// Lay down depth with shader first (NULL turns it off), so the shading pass only runs
+	// on the fragments that end up visible. Its vertex stage must match the items' shaders.
+	void setDepthPrepass(Shader* shader) { depthShader = shader; }
+
+	// Shade every item with shader (e.g. to fill a G-buffer) instead of its own; NULL goes
+	// back to each item's shader. Its vertex stage must match the items' shaders.
+	void setShadingShader(Shader* shader) { shadingShader = shader; }
+
+	// Count the fragments the shading pass writes; the total shows up a frame later
+	void setCountOverdraw(bool b) { countOverdraw = b; }
+
+	// Multi-draw indirect with a base instance needs OpenGL 4.3
+	static bool supportsIndirect()
+	{
+		return GLAD_GL_VERSION_4_3 && glMultiDrawElementsIndirect != NULL;
+	}
+
+	// Skip what's outside the view frustum, in cells hidden behind closed portals, or beyond
+	// every light's reach; each is counted apart in the stats
+	void setFrustumCulling(bool b) { frustumCulling = b; }
+	void setCellCulling(bool b) { cellCulling = b; }
+	void setLightCulling(bool b) { lightCulling = b; }
+
+	// Cell graph whose visible cells limit what gets drawn, already updated for this frame
+	void setCells(const CellGraph* inCells) { cells = inCells; }
+	const CellGraph* getCells() { return cells; }
+	const Frustum& getFrustum() { return frustum; }
+
+	// Anything further than its radius from every light shades black (see lightRange()), so
+	// it is culled. Lights are added each frame after clearing the last frame's; a light with
+	// a negative radius reaches everywhere, which turns this off.
+	void clearLightRanges()
+	{
+		lightRanges.clear();
+		lightEverywhere = false;
+	}
+	void addLightRange(glm::vec3 position, float radius)
+	{
+		if (radius < 0.0f) lightEverywhere = true;
+		else if (radius > 0.0f) lightRanges.push_back(glm::vec4(position, radius));
+	}
+
+	// Start collecting a new frame, seen from viewPos through viewProjection
+	void begin(glm::vec3 inViewPos, const glm::mat4& viewProjection)
+	{
+		viewPos = inViewPos;
+		frustum.extract(viewProjection);
+		entitiesCulled = 0;
+		partsCulled = 0;
+		unlitCulled = 0;
+		lodPartsSaved = 0;
+		items.clear();
+	}
+
+	// Whether anything overlapping these cells (see CellGraph::overlapMask) may be seen
+	bool cellsVisible(unsigned int mask)
+	{
+		return !cellCulling || cells == NULL || cells->canSee(mask);
+	}
+
+	// Whether any of the box is close enough to a light to be lit
+	bool inLightRange(const AABB& bounds)
+	{
+		if (!lightCulling || lightEverywhere) return true;
+		for (size_t ii = 0; ii < lightRanges.size(); ii++)
+		{
+			float radius = lightRanges[ii].w;
+			if (bounds.distanceSquared(glm::vec3(lightRanges[ii])) <= radius * radius) return true;
+		}
+		return false;
+	}
+
+	// Whether a piece of static scenery in these cells, within these bounds, can be skipped
+	bool cullStatic(unsigned int cellMask, const AABB& bounds)
+	{
+		if (!cellsVisible(cellMask)) return true;
+		if (inLightRange(bounds)) return false;
+		unlitCulled++;
+		return true;
+	}
+
+	// Where an entity's world bounds lie against the view, treating anything in hidden cells
+	// as OUTSIDE; those are counted as culled. Entities the light can't reach are OUTSIDE too,
+	// counted separately. Whatever isn't culled is INSIDE while frustum culling is off.
+	Visibility cullEntity(const AABB& bounds)
+	{
+		if (!inLightRange(bounds))
+		{
+			unlitCulled++;
+			return OUTSIDE;
+		}
+
+		Visibility result = OUTSIDE;
+		if (cellsVisible(cells == NULL ? 0 : cells->overlapMask(bounds)))
+		{
+			result = frustumCulling ? frustum.classify(bounds) : INSIDE;
+		}
+		if (result == OUTSIDE) entitiesCulled++;
+		return result;
+	}
+
+	// An entity was drawn with numParts fewer parts thanks to its level of detail (see
+	// World::addLod)
+	void countLod(int numParts) { lodPartsSaved += numParts; }
+
+	// Whether one part of a partly visible entity can be seen
+	bool partVisible(const AABB& bounds)
+	{
+		if (!frustumCulling || frustum.classify(bounds) != OUTSIDE) return true;
+		partsCulled++;
+		return false;
+	}
+
+	// Draw the whole box mesh
+	void submit(Shader& shader, unsigned int VAO, unsigned int *textures, int numTextures,
+		const glm::mat4& model)
+	{
+		push(shader, VAO, textures, numTextures, model, 0, BOX_INDICES,
+			glm::length(glm::vec3(model[3]) - viewPos));
+	}
+
+	// Draw count indices from first, sorted by the nearest point of their bounds
+	void submitRange(Shader& shader, unsigned int VAO, unsigned int *textures, int numTextures,
+		const glm::mat4& model, int first, int count, const AABB& bounds)
+	{
+		push(shader, VAO, textures, numTextures, model, first, count,
+			sqrtf(bounds.distanceSquared(viewPos)));
+	}
+
+	// Sort and draw everything collected since begin()
+	void flush(FrameStats& stats)
+	{
+		PROFILE_ZONE("RenderQueue::flush");
+		std::sort(items.begin(), items.end(), byKey);
+
+		bool useIndirect = indirect && supportsIndirect();
+		if (useIndirect) prepareIndirect();
+		int bindsIssued = 0;
+		int naiveBinds = 0;
+
+		// Depth only, then shade where the depth matches exactly
+		if (depthShader != NULL)
+		{
+			glState().colorMask(false);
+			drawPass(stats, depthShader, false, useIndirect, bindsIssued, naiveBinds);
+			glState().colorMask(true);
+			glState().depthFunc(GL_EQUAL);
+			glState().depthMask(false);
+		}
+
+		// Pick up the count from the last frame, and start this frame's
+		if (countOverdraw)
+		{
+			if (overdrawQueries[0] == 0) glGenQueries(2, overdrawQueries);
+			unsigned int query = overdrawQueries[overdrawFrame % 2];
+			if (overdrawFrame > 0)
+			{
+				GLuint samples = 0;
+				glGetQueryObjectuiv(overdrawQueries[(overdrawFrame + 1) % 2], GL_QUERY_RESULT, &samples);
+				GLint viewport[4];
+				glGetIntegerv(GL_VIEWPORT, viewport);
+				stats.fragmentsShaded = (int)samples;
+				stats.pixels = viewport[2] * viewport[3];
+			}
+			glBeginQuery(GL_SAMPLES_PASSED, query);
+		}
+
+		drawPass(stats, shadingShader, true, useIndirect, bindsIssued, naiveBinds);
+
+		if (countOverdraw)
+		{
+			glEndQuery(GL_SAMPLES_PASSED);
+			overdrawFrame++;
+		}
+		else
+		{
+			overdrawFrame = 0;
+		}
+		if (depthShader != NULL)
+		{
+			glState().depthFunc(GL_LESS);
+			glState().depthMask(true);
+		}
+
+		stats.drawItems += (int)items.size();
+		stats.bindsIssued += bindsIssued;
+		stats.bindsAvoided += naiveBinds - bindsIssued;
+		stats.entitiesCulled += entitiesCulled;
+		stats.partsCulled += partsCulled;
+		stats.unlitCulled += unlitCulled;
+		stats.lodPartsSaved += lodPartsSaved;
+		if (cells != NULL)
+		{
+			stats.cellsTotal = cells->getNumCells();
+			stats.cellsVisible = cellCulling ? cells->getVisibleCount() : stats.cellsTotal;
+		}
+		items.clear();
+	}
+};
+
+#endif
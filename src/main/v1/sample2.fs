@@ -1,13 +1,16 @@
 #version 330 core
 out vec4 FragColor;
 
-struct Material {
-    sampler2D diffuse;
-    sampler2D specular;    
-    float shininess;
-}; 
+// Shared with every shader through uniform buffers (see uniform_blocks.hpp)
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
 
-struct Light {
+layout (std140) uniform Light
+{
     vec3 position;
 
     vec3 ambient;
@@ -17,44 +20,134 @@ struct Light {
 	float constant;
 	float linear;
 	float quadratic;
-};
+	float shadowFar; // 0 when it casts no shadows
+} light;
+
+layout (std140) uniform Material
+{
+    float shininess;
+} material;
+
+layout (std140) uniform Clusters
+{
+    ivec4 grid;     // clusters across, down and in depth, and the number of point lights
+    vec4 scale;     // tile size in pixels, then slice = log(depth) * z - w
+} clusters;
 
 in vec3 FragPos;  
 in vec3 Normal;  
 in vec2 TexCoords;
-  
-uniform vec3 viewPos;
-uniform Material material;
-uniform Light light;
 
-void main()
+uniform sampler2D diffuseMap;
+uniform sampler2D specularMap;
+
+// Point lights, and the ones reaching each cluster (see clusters.hpp)
+uniform samplerBuffer pointLights;      // one LightBlock per 5 texels
+uniform usamplerBuffer clusterRanges;   // first, count
+uniform usamplerBuffer clusterLights;   // indices into pointLights
+
+const int LIGHT_TEXELS = 5;
+
+struct PointLight
+{
+    vec3 position;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+	float constant;
+	float linear;
+	float quadratic;
+};
+
+// Phong lighting from one light, fading with distance; lit is 0 where it's in shadow
+vec3 shade(PointLight source, vec3 norm, vec3 viewDir, vec3 diffuseColor, vec3 specularColor,
+    float lit)
 {
     // ambient
-    vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
+    vec3 ambient = source.ambient * diffuseColor;
   	
     // diffuse 
-    vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(light.position - FragPos);
+    vec3 lightDir = normalize(source.position - FragPos);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoords).rgb;  
+    vec3 diffuse = source.diffuse * diff * diffuseColor;  
     
     // specular
-    vec3 viewDir = normalize(viewPos - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);  
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    vec3 specular = light.specular * spec * texture(material.specular, TexCoords).rgb;
+    vec3 specular = source.specular * spec * specularColor;
 
 	// attenuation
-    float distance    = length(light.position - FragPos);
+    float distance    = length(source.position - FragPos);
     float attenuation = 1.0 / (
-		light.constant + light.linear * distance + light.quadratic * (distance * distance)
+		source.constant + source.linear * distance + source.quadratic * (distance * distance)
 	);    
 
     ambient  	*= attenuation;  
-    diffuse 	*= attenuation;
-    specular 	*= attenuation;   
+    diffuse 	*= attenuation * lit;
+    specular 	*= attenuation * lit;   
  
-        
-    vec3 result = ambient + diffuse + specular;
+    return ambient + diffuse + specular;
+}
+
+// Shadow cubes of the main light (see shadow_map.hpp): the distance to the nearest static
+// and moving caster in each direction, over light.shadowFar
+uniform samplerCube staticShadows;
+uniform samplerCube dynamicShadows;
+
+// Slack for depth precision and for the static cube being drawn from up to 0.1 away
+const float SHADOW_BIAS = 0.15;
+
+// 1 where the main light reaches the fragment, 0 where something nearer to it is in the way
+float mainLightVisible()
+{
+    if (light.shadowFar <= 0.0) return 1.0;
+
+    vec3 fromLight = FragPos - light.position;
+    float closest = min(texture(staticShadows, fromLight).r, texture(dynamicShadows, fromLight).r);
+    return length(fromLight) - SHADOW_BIAS > closest * light.shadowFar ? 0.0 : 1.0;
+}
+
+PointLight fetchLight(int index)
+{
+    int base = index * LIGHT_TEXELS;
+    vec4 specularConstant = texelFetch(pointLights, base + 3);
+    vec4 falloff = texelFetch(pointLights, base + 4);
+    return PointLight(
+        texelFetch(pointLights, base).xyz, texelFetch(pointLights, base + 1).xyz,
+        texelFetch(pointLights, base + 2).xyz, specularConstant.xyz,
+        specularConstant.w, falloff.x, falloff.y
+    );
+}
+
+void main()
+{
+    vec3 diffuseColor = texture(diffuseMap, TexCoords).rgb;
+    vec3 specularColor = texture(specularMap, TexCoords).rgb;
+    vec3 norm = normalize(Normal);
+    vec3 viewDir = normalize(viewPos - FragPos);
+
+    vec3 result = shade(PointLight(light.position, light.ambient, light.diffuse, light.specular,
+        light.constant, light.linear, light.quadratic), norm, viewDir, diffuseColor, specularColor,
+        mainLightVisible());
+
+    // Only the point lights reaching this fragment's cluster
+    if (clusters.grid.w > 0)
+    {
+        float depth = -(view * vec4(FragPos, 1.0)).z;
+        ivec3 cluster = ivec3(ivec2(gl_FragCoord.xy / clusters.scale.xy),
+            int(floor(log(max(depth, 1e-6)) * clusters.scale.z - clusters.scale.w)));
+        cluster = clamp(cluster, ivec3(0), clusters.grid.xyz - 1);
+
+        int index = (cluster.z * clusters.grid.y + cluster.y) * clusters.grid.x + cluster.x;
+        uvec2 range = texelFetch(clusterRanges, index).xy;
+        for (uint ii = 0u; ii < range.y; ii++)
+        {
+            int lightIndex = int(texelFetch(clusterLights, int(range.x + ii)).r);
+            result += shade(fetchLight(lightIndex), norm, viewDir, diffuseColor, specularColor, 1.0);
+        }
+    }
+
     FragColor = vec4(result, 1.0);
 } 
@@ -2,19 +2,33 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in mat4 aInstanceModel;  // per-instance, locations 3-6
+layout (location = 7) in mat3 aInstanceNormal; // per-instance, locations 7-9
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 
+// The depth pre-pass reuses this stage, and the shading pass tests for GL_EQUAL depth
+invariant gl_Position;
+
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform mat3 normalMatrix; // transpose(inverse(mat3(model))), worked out on the CPU
+uniform bool instanced;
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;  
+    mat4 partModel = instanced ? aInstanceModel : model;
+    mat3 partNormal = instanced ? aInstanceNormal : normalMatrix;
+    FragPos = vec3(partModel * vec4(aPos, 1.0));
+    Normal = partNormal * aNormal;  
     TexCoords = aTexCoords;
     
     gl_Position = projection * view * vec4(FragPos, 1.0);
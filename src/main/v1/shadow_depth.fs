@@ -0,0 +1,11 @@
+#version 330 core
+in vec4 FragPos;
+
+uniform vec3 lightPos;
+uniform float farPlane;
+
+// Store the distance to the light, scaled into [0, 1] by the shadow's far plane
+void main()
+{
+    gl_FragDepth = length(FragPos.xyz - lightPos) / farPlane;
+}
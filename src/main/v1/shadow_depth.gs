@@ -0,0 +1,23 @@
+#version 330 core
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 18) out;
+
+// Copy each triangle to all six faces of the shadow cube
+uniform mat4 shadowMatrices[6];
+
+out vec4 FragPos; // world space
+
+void main()
+{
+    for (int face = 0; face < 6; face++)
+    {
+        gl_Layer = face;
+        for (int ii = 0; ii < 3; ii++)
+        {
+            FragPos = gl_in[ii].gl_Position;
+            gl_Position = shadowMatrices[face] * FragPos;
+            EmitVertex();
+        }
+        EndPrimitive();
+    }
+}
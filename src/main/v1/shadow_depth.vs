@@ -0,0 +1,14 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in mat4 aInstanceModel;  // per-instance, locations 3-6
+
+// Shadow cube pass: the same inputs as sample2.vs, but only the world position is needed,
+// and shadow_depth.gs does the projecting
+uniform mat4 model;
+uniform bool instanced;
+
+void main()
+{
+    mat4 partModel = instanced ? aInstanceModel : model;
+    gl_Position = partModel * vec4(aPos, 1.0);
+}
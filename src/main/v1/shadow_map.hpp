@@ -0,0 +1,192 @@
+#ifndef SHADOW_MAP_HPP
+#define SHADOW_MAP_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/shader_m.h>
+
+#include <iostream>
+#include <string>
+
+#include "gl_state.hpp"
+
+static const int SHADOW_SIZE = 512;				// texels along each side of a cube face
+static const float SHADOW_NEAR = 0.05f;
+static const float SHADOW_MOVE_THRESHOLD = 0.1f;	// see sample2.fs's SHADOW_BIAS
+
+// Texture units the shadow cubes are read from: static casters, then dynamic ones
+static const unsigned int SHADOW_UNIT = 8;
+
+// Omnidirectional shadows for the main light. Each cube map face holds the distance from the
+// light to the nearest caster in that direction (written by shadow_depth.vs/gs/fs, all six
+// faces in one pass). Static scenery goes in a cube of its own, which is only redrawn when
+// the light has moved more than SHADOW_MOVE_THRESHOLD, its reach changed or the scenery
+// changed; moving casters are redrawn into the second cube every frame. The shaders take the
+// nearer of the two.
+class PointShadowMap
+{
+
+private:
+
+	// Fields
+	Shader depth;
+	Uniform<glm::vec3> lightPosUniform;
+	Uniform<float> farPlaneUniform;
+	Uniform<glm::mat4> matrixUniforms[6];
+	unsigned int FBO;
+	unsigned int cubes[2]; // static, dynamic
+	glm::vec3 lightPos;
+	float farPlane;
+
+	// What the static cube was drawn for
+	bool staticValid;
+	glm::vec3 staticLightPos;
+	float staticFarPlane;
+	unsigned int staticRevision;
+	int staticRedraws;
+
+	void beginCube(unsigned int cube)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cube, 0);
+		glViewport(0, 0, SHADOW_SIZE, SHADOW_SIZE);
+		glClear(GL_DEPTH_BUFFER_BIT);
+	}
+
+public:
+
+	PointShadowMap(const PointShadowMap&) = delete;
+	PointShadowMap& operator=(const PointShadowMap&) = delete;
+
+	// Constructor
+	PointShadowMap()
+		: depth("./shadow_depth.vs", "./shadow_depth.fs", "./shadow_depth.gs")
+	{
+		lightPosUniform = depth.uniform<glm::vec3>("lightPos");
+		farPlaneUniform = depth.uniform<float>("farPlane");
+		for (int ii = 0; ii < 6; ii++)
+		{
+			std::string name = "shadowMatrices[" + std::to_string(ii) + "]";
+			matrixUniforms[ii] = depth.uniform<glm::mat4>(name.c_str());
+		}
+
+		glGenTextures(2, cubes);
+		for (int cc = 0; cc < 2; cc++)
+		{
+			glState().bindTexture(SHADOW_UNIT + cc, cubes[cc], GL_TEXTURE_CUBE_MAP);
+			glState().activeTexture(SHADOW_UNIT + cc);
+			for (int face = 0; face < 6; face++)
+			{
+				glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT24,
+					SHADOW_SIZE, SHADOW_SIZE, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+			}
+			glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		}
+
+		glGenFramebuffers(1, &FBO);
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cubes[0], 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "Shadow framebuffer is incomplete" << std::endl;
+		}
+		glState().bindScreen();
+
+		lightPos = glm::vec3(0.0f, 0.0f, 0.0f);
+		farPlane = 1.0f;
+		staticValid = false;
+		staticLightPos = lightPos;
+		staticFarPlane = farPlane;
+		staticRevision = 0;
+		staticRedraws = 0;
+	}
+
+	~PointShadowMap()
+	{
+		glDeleteFramebuffers(1, &FBO);
+		glState().deleteTexture(cubes[0]);
+		glState().deleteTexture(cubes[1]);
+	}
+
+	// Shader the render queue should draw casters with
+	Shader& getShader() { return depth; }
+
+	// Place the light for this frame, casting shadows out to farPlane
+	void setLight(glm::vec3 position, float inFarPlane)
+	{
+		lightPos = position;
+		farPlane = inFarPlane;
+
+		glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, SHADOW_NEAR, farPlane);
+		glm::vec3 targets[] = {
+			glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+			glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+			glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+		};
+		glm::vec3 ups[] = {
+			glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+			glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+			glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+		};
+
+		glState().useProgram(depth.ID);
+		for (int face = 0; face < 6; face++)
+		{
+			depth.set(matrixUniforms[face],
+				projection * glm::lookAt(position, position + targets[face], ups[face]));
+		}
+		depth.set(lightPosUniform, position);
+		depth.set(farPlaneUniform, farPlane);
+	}
+
+	// Whether the static cube is out of date, given the static scenery's revision
+	bool staticStale(unsigned int revision)
+	{
+		return !staticValid || revision != staticRevision || farPlane != staticFarPlane
+			|| glm::length(lightPos - staticLightPos) > SHADOW_MOVE_THRESHOLD;
+	}
+
+	// Start drawing static casters, for the scenery at this revision
+	void beginStatic(unsigned int revision)
+	{
+		beginCube(cubes[0]);
+		staticValid = true;
+		staticLightPos = lightPos;
+		staticFarPlane = farPlane;
+		staticRevision = revision;
+		staticRedraws++;
+	}
+
+	// Start drawing moving casters
+	void beginDynamic()
+	{
+		beginCube(cubes[1]);
+	}
+
+	// Go back to drawing on screen, with a viewport of the given size
+	void end(int width, int height)
+	{
+		glState().bindScreen();
+		glViewport(0, 0, width, height);
+	}
+
+	// Bind both cubes for the lighting shaders
+	void bind()
+	{
+		glState().bindTexture(SHADOW_UNIT, cubes[0], GL_TEXTURE_CUBE_MAP);
+		glState().bindTexture(SHADOW_UNIT + 1, cubes[1], GL_TEXTURE_CUBE_MAP);
+	}
+
+	// Times the static cube has been drawn, to see how well it's cached
+	int getStaticRedraws() { return staticRedraws; }
+};
+
+#endif
@@ -0,0 +1,230 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+
+#include <math.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "clock.hpp"
+#include "entity.hpp"
+#include "frustum.hpp"
+#include "profiler.hpp"
+#include "render_queue.hpp"
+
+// The simulation and the renderer run on threads of their own, and only ever trade the
+// copies below through triple buffers (see triple_buffer.hpp). Neither waits on the other:
+// the renderer draws the newest finished snapshot, and the simulation plays on with the
+// newest input. Ticks are a fixed length apart, so the renderer blends the last two it got
+// for whatever moment in between it draws (see SnapshotBlender).
+
+// What the player is doing, sampled on the main thread each frame. Presses that mustn't be
+// lost between two ticks are counted rather than held.
+struct InputSnapshot
+{
+	bool forward, back, left, right;	// WASD held
+	bool run;							// shift held
+	bool interact;						// E held
+	bool brighter, dimmer;				// L and K held
+	unsigned int interactions;			// E presses so far
+	unsigned int restarts;				// R presses so far
+	double mouseX, mouseY;				// where the cursor last was
+	unsigned int mouseMoves;			// times it has moved so far
+	float lodScale;						// see FrameSnapshot::lodScale
+};
+
+// One entity as a tick left it
+struct EntitySnapshot
+{
+	unsigned int source;		// the entity's id (see World), to find it again in another tick
+	unsigned int *textures;
+	int numTextures;
+	AABB bounds;				// around every part
+	int firstPart, numParts;	// into FrameSnapshot::partModels and partBounds
+	int partsSaved;				// left out by its level of detail
+	bool castsShadow;			// false for whatever holds the light
+	Transform transform;		// where it was and how it was turned, to place its parts again
+	float bob;					// when blending (see SnapshotBlender)
+	glm::vec3 *scales, *positions;	// of its parts, from its level of detail
+};
+
+// One model part of the static scenery, in world space
+struct StaticPart
+{
+	glm::mat4 model;
+	unsigned int *textures;
+	int numTextures;
+};
+
+// The scenery's parts are shared between snapshots until some of it changes
+typedef std::shared_ptr<const std::vector<StaticPart> > SceneryParts;
+
+// Everything the renderer needs from one tick of the simulation
+struct FrameSnapshot
+{
+	unsigned int tick;
+	double time;			// on clockSeconds(), when the world was as below
+	unsigned int restarts;	// nothing is blended across a restart
+	glm::vec3 cameraPos, cameraFront, cameraUp;
+	glm::vec3 lightPos;
+	float lightRadius;		// the light's quadratic falloff in the dark
+	bool doorOpen;
+	float lodScale;			// distances are divided by this to pick levels of detail (0 for none)
+	std::vector<EntitySnapshot> entities;
+	std::vector<glm::mat4> partModels;
+	std::vector<AABB> partBounds;
+	std::vector<float> partPitches;		// each part's own pitch, swinging or the entity's
+	std::vector<glm::vec3> glows;		// pickups still lying around
+	SceneryParts scenery;
+	unsigned int sceneryRevision;		// changes whenever the scenery does
+
+	// Empty the lists for a new tick, keeping their memory
+	void clear()
+	{
+		entities.clear();
+		partModels.clear();
+		partBounds.clear();
+		partPitches.clear();
+		glows.clear();
+		scenery.reset();
+	}
+
+	// How far away something at position counts as for picking its level of detail; 0 keeps
+	// the full models
+	float lodDistance(glm::vec3 position) const
+	{
+		if (lodScale <= 0.0f) return 0.0f;
+		return glm::length(position - cameraPos) / lodScale;
+	}
+};
+
+// Holds on to the last two snapshots the renderer got, and blends them for the moment a
+// frame shows. What places an entity (where it is, its bob, its turns and each part's pitch)
+// is blended, and its parts are placed again from that, so they turn through the angles in
+// between rather than shrinking towards a blend of two matrices; at low tick rates a pickup
+// spins a good way in a tick. Anything without a match in the tick before (just picked up,
+// a different level of detail) shows as it is.
+class SnapshotBlender
+{
+
+private:
+
+	// Fields
+	FrameSnapshot previous, latest, blended;
+	bool started;
+
+	template <typename T>
+	static T mix(const T& from, const T& to, float amount)
+	{
+		return from + (to - from) * amount;
+	}
+
+	// Between two angles in degrees, the short way round (a spin wraps from 360 to 0)
+	static float mixAngle(float from, float to, float amount)
+	{
+		float turn = to - from;
+		turn -= 360.0f * floorf((turn + 180.0f) / 360.0f);
+		return from + turn * amount;
+	}
+
+	// The same entity in the tick before, if its parts still line up
+	const EntitySnapshot* findPrevious(const EntitySnapshot& entity, size_t hint)
+	{
+		if (hint < previous.entities.size() && previous.entities[hint].source == entity.source
+			&& previous.entities[hint].numParts == entity.numParts) return &previous.entities[hint];
+		for (size_t ii = 0; ii < previous.entities.size(); ii++)
+		{
+			if (previous.entities[ii].source == entity.source
+				&& previous.entities[ii].numParts == entity.numParts) return &previous.entities[ii];
+		}
+		return NULL;
+	}
+
+public:
+
+	// Constructor
+	SnapshotBlender()
+	{
+		started = false;
+	}
+
+	// The world as it was at time, between the last two snapshots. Times before the earlier
+	// one show that, and times past the newest show the newest.
+	const FrameSnapshot& blend(const FrameSnapshot& newest, double time)
+	{
+		if (!started || newest.tick != latest.tick)
+		{
+			previous = started ? latest : newest;
+			latest = newest;
+			started = true;
+		}
+
+		double span = latest.time - previous.time;
+		if (span <= 0.0 || time >= latest.time || previous.restarts != latest.restarts) return latest;
+		float amount = (float)std::max((time - previous.time) / span, 0.0);
+
+		blended = latest;
+		blended.cameraPos = mix(previous.cameraPos, latest.cameraPos, amount);
+		blended.cameraFront = glm::normalize(mix(previous.cameraFront, latest.cameraFront, amount));
+		blended.lightPos = mix(previous.lightPos, latest.lightPos, amount);
+		if (previous.glows.size() == latest.glows.size())
+		{
+			for (size_t ii = 0; ii < blended.glows.size(); ii++)
+			{
+				blended.glows[ii] = mix(previous.glows[ii], latest.glows[ii], amount);
+			}
+		}
+
+		for (size_t ii = 0; ii < blended.entities.size(); ii++)
+		{
+			EntitySnapshot& entity = blended.entities[ii];
+			const EntitySnapshot* before = findPrevious(entity, ii);
+			if (before == NULL) continue;
+
+			Transform& transform = entity.transform;
+			transform.position = mix(before->transform.position, transform.position, amount);
+			transform.anchor = mix(before->transform.anchor, transform.anchor, amount);
+			transform.yaw = mixAngle(before->transform.yaw, transform.yaw, amount);
+			transform.pitch = mixAngle(before->transform.pitch, transform.pitch, amount);
+			transform.roll = mixAngle(before->transform.roll, transform.roll, amount);
+			entity.bob = mix(before->bob, entity.bob, amount);
+
+			entity.bounds = AABB();
+			for (int jj = 0; jj < entity.numParts; jj++)
+			{
+				int part = entity.firstPart + jj;
+				float pitch = mixAngle(previous.partPitches[before->firstPart + jj], latest.partPitches[part], amount);
+				blended.partPitches[part] = pitch;
+				blended.partModels[part] = partModel(transform, entity.positions[jj], entity.scales[jj], entity.bob, pitch);
+				blended.partBounds[part] = AABB::ofUnitBox(blended.partModels[part]);
+				entity.bounds.extend(blended.partBounds[part]);
+			}
+		}
+		return blended;
+	}
+};
+
+// Submit the parts of an entity that can be seen. Parts only need testing on their own when
+// the entity straddles the view.
+inline void submitEntity(RenderQueue &queue, const FrameSnapshot& frame,
+	const EntitySnapshot& entity, unsigned int VAO, Shader &shader)
+{
+	PROFILE_ZONE("submitEntity");
+	Visibility visibility = queue.cullEntity(entity.bounds);
+	if (visibility == OUTSIDE) return;
+	queue.countLod(entity.partsSaved);
+
+	for (int ii = entity.firstPart; ii < entity.firstPart + entity.numParts; ii++)
+	{
+		if (visibility == INSIDE || queue.partVisible(frame.partBounds[ii]))
+		{
+			queue.submit(shader, VAO, entity.textures, entity.numTextures, frame.partModels[ii]);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef STATIC_BATCH_HPP
+#define STATIC_BATCH_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+
+#include <vector>
+
+#include "gl_state.hpp"
+#include "primitive_mesh.hpp"
+#include "render_queue.hpp"
+#include "snapshot.hpp"
+
+// Scenery that never moves (walls, door, tables, ground). Every part of every visible static
+// entity comes in already placed in world space (see FrameSnapshot::scenery), and is merged
+// into a single vertex/index buffer grouped by the cells it lies in and texture pair, so the
+// whole lot draws in one call per material and set of cells. The batch is only rebuilt when
+// the scenery's revision changes (e.g. the door being hidden).
+class StaticBatch
+{
+
+private:
+
+	// A contiguous index range sharing one texture pair and set of cells
+	struct Segment
+	{
+		unsigned int *textures;
+		int numTextures;
+		unsigned int cellMask;
+		AABB bounds;
+		int first, count;
+	};
+
+	// One model part waiting to be baked
+	struct Part
+	{
+		const StaticPart* source;
+		AABB bounds;
+		unsigned int cellMask;
+	};
+
+	// Fields
+	SceneryParts sources;
+	unsigned int revision;
+	std::vector<Segment> segments;
+	std::vector<PackedVertex> vertices;
+	std::vector<unsigned int> indices;
+	std::vector<float> boxVertices;			// unique vertices of the box mesh, VERTEX_FLOATS each
+	std::vector<unsigned int> boxIndices;	// box triangles, indexing boxVertices
+	unsigned int VAO, VBO, EBO;
+	unsigned int builtRevision;
+	bool built;
+
+	static bool sameSegment(const Segment& seg, const Part& part)
+	{
+		const StaticPart* source = part.source;
+		if (seg.cellMask != part.cellMask || seg.numTextures != source->numTextures) return false;
+		for (int ii = 0; ii < seg.numTextures; ii++)
+		{
+			if (seg.textures[ii] != source->textures[ii]) return false;
+		}
+		return true;
+	}
+
+	// Append one part, transformed into world space
+	void appendPart(const Part& part)
+	{
+		const glm::mat4& model = part.source->model;
+		glm::mat3 normals = normalMatrix(model);
+		unsigned int base = (unsigned int)vertices.size();
+
+		for (size_t vv = 0; vv < boxVertices.size(); vv += VERTEX_FLOATS)
+		{
+			const float* v = &boxVertices[vv];
+			glm::vec3 pos = glm::vec3(model * glm::vec4(v[0], v[1], v[2], 1.0f));
+			glm::vec3 normal = glm::normalize(normals * glm::vec3(v[3], v[4], v[5]));
+
+			vertices.push_back(packVertex(pos, normal, glm::vec2(v[6], v[7])));
+		}
+		for (size_t kk = 0; kk < boxIndices.size(); kk++)
+		{
+			indices.push_back(base + boxIndices[kk]);
+		}
+	}
+
+public:
+
+	// Constructor -- parts are copies of the box mesh; the identity model matrix instanced
+	// draws need comes from VBO_instance
+	StaticBatch(PrimitiveMesh &box, unsigned int VBO_instance)
+	{
+		boxVertices = box.getVertices();
+		boxIndices = box.getIndices();
+
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glGenBuffers(1, &EBO);
+
+		glState().bindVertexArray(VAO);
+		glState().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		attachPackedAttributes(VBO);
+		attachInstanceAttributes(VBO_instance);
+		glState().bindVertexArray(0);
+
+		revision = 0;
+		builtRevision = 0;
+		built = false;
+	}
+
+	~StaticBatch()
+	{
+		glState().deleteVertexArray(VAO);
+		glState().deleteBuffer(VBO);
+		glState().deleteBuffer(EBO);
+	}
+
+	// Take the scenery as of inRevision; it's only baked again when that changed
+	void setScenery(const SceneryParts& parts, unsigned int inRevision)
+	{
+		if (inRevision == revision) return;
+		sources = parts;
+		revision = inRevision;
+	}
+
+	bool isDirty()
+	{
+		return !built || builtRevision != revision;
+	}
+
+	// Changes whenever the scenery does
+	unsigned int getRevision() { return revision; }
+
+	// Bake the scenery into the merged buffers. Each part is tagged with the cells it overlaps
+	// (none without a cell graph), so segments can be skipped per cell.
+	void build(const CellGraph* cells)
+	{
+		vertices.clear();
+		indices.clear();
+		segments.clear();
+
+		std::vector<Part> parts;
+		for (size_t ii = 0; sources && ii < sources->size(); ii++)
+		{
+			Part part;
+			part.source = &(*sources)[ii];
+			part.bounds = AABB::ofUnitBox(part.source->model);
+			part.cellMask = cells == NULL ? 0 : cells->overlapMask(part.bounds);
+			parts.push_back(part);
+		}
+
+		// Group by cells and material, keeping the first-seen order
+		std::vector<bool> done(parts.size(), false);
+		for (size_t ii = 0; ii < parts.size(); ii++)
+		{
+			if (done[ii]) continue;
+
+			Segment seg;
+			seg.textures = parts[ii].source->textures;
+			seg.numTextures = parts[ii].source->numTextures;
+			seg.cellMask = parts[ii].cellMask;
+			seg.bounds = AABB();
+			seg.first = (int)indices.size();
+
+			for (size_t jj = ii; jj < parts.size(); jj++)
+			{
+				if (!done[jj] && sameSegment(seg, parts[jj]))
+				{
+					appendPart(parts[jj]);
+					seg.bounds.extend(parts[jj].bounds);
+					done[jj] = true;
+				}
+			}
+
+			seg.count = (int)indices.size() - seg.first;
+			segments.push_back(seg);
+		}
+
+		glState().bindVertexArray(VAO);
+		glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(PackedVertex),
+			vertices.empty() ? NULL : &vertices[0], GL_STATIC_DRAW);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
+			indices.empty() ? NULL : &indices[0], GL_STATIC_DRAW);
+		glState().bindVertexArray(0);
+
+		builtRevision = revision;
+		built = true;
+	}
+
+	// Submit one draw per material in each group of visible cells (unless it's all beyond the
+	// light), rebuilding first if anything changed
+	void render(RenderQueue &queue, Shader &shader)
+	{
+		if (isDirty()) build(queue.getCells());
+
+		for (size_t ii = 0; ii < segments.size(); ii++)
+		{
+			if (queue.cullStatic(segments[ii].cellMask, segments[ii].bounds)) continue;
+			queue.submitRange(shader, VAO, segments[ii].textures, segments[ii].numTextures,
+				glm::mat4(), segments[ii].first, segments[ii].count, segments[ii].bounds);
+		}
+	}
+};
+
+#endif
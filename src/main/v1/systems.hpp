@@ -0,0 +1,214 @@
+#ifndef SYSTEMS_HPP
+#define SYSTEMS_HPP
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <math.h>
+#include <vector>
+
+#include "entity.hpp"
+#include "frustum.hpp"
+#include "profiler.hpp"
+#include "snapshot.hpp"
+
+// The systems: each does one thing to every entity with the components it needs, walking
+// the World's arrays in order.
+
+// A curve swinging between -PITCH_ANIMATION_LIMIT and PITCH_ANIMATION_LIMIT degrees at rate
+// degrees a second (up first, or down if negative), for addSwing()
+inline int addSwingCurve(World& world, float rate)
+{
+	float quarter = PITCH_ANIMATION_LIMIT / fabs(rate);
+	float limit = rate < 0.0f ? -PITCH_ANIMATION_LIMIT : PITCH_ANIMATION_LIMIT;
+	Keyframe keys[] = {
+		{ 0.0f, 0.0f, 0.0f },
+		{ quarter, limit, 0.0f },
+		{ 3.0f * quarter, -limit, 0.0f },
+		{ 4.0f * quarter, 0.0f, 0.0f }
+	};
+	return world.addKeyframeCurve(keys, 4);
+}
+
+// A curve bobbing a tenth of a unit either way, once a second, for addBob()
+inline int addBobCurve(World& world)
+{
+	AnimationCurve curve = { TRACK_SINE, 0.1f, ANIMATION_SPEED / 360.0f, 0.0f, 0, 0, 0.0f, 0.0, -1.0, 0.0f };
+	return world.addCurve(curve);
+}
+
+// A curve turning round at ANIMATION_SPEED, for addSpin()
+inline int addSpinCurve(World& world)
+{
+	AnimationCurve curve = { TRACK_RAMP, 360.0f, ANIMATION_SPEED, 0.0f, 0, 0, 0.0f, 0.0, -1.0, 0.0f };
+	return world.addCurve(curve);
+}
+
+// Swing part of an entity back and forth along a swing curve, from the entity's pitch
+inline void addSwing(World& world, EntityId id, int part, int curve)
+{
+	world.addTrack(id, TRACK_PITCH, part, curve, world.transform(id).pitch);
+}
+
+// Bob an entity up and down along a bob curve
+inline void addBob(World& world, EntityId id, int curve)
+{
+	world.addTrack(id, TRACK_BOB, 0, curve, 0.0f);
+}
+
+// Spin an entity about its yaw along a spin curve, from where it faces
+inline void addSpin(World& world, EntityId id, int curve)
+{
+	world.addTrack(id, TRACK_YAW, 0, curve, world.transform(id).yaw);
+}
+
+// Move the tracks' clock on by dt seconds and evaluate every track for it, in one pass; then
+// hand each entity what its bob and yaw tracks say. Part pitches are read from the tracks
+// where they're needed (see snapshotSystem()).
+inline void animationSystem(World& world, float dt)
+{
+	PROFILE_ZONE("animationSystem");
+	world.advance(dt);
+	animateTracks(world.tracks, world.curves, world.keyframes, world.getTime(), world.trackValues);
+
+	for (int row = 0; row < world.getCount(); row++)
+	{
+		if (!(world.masks[row] & HAS_ANIMATION)) continue;
+		Animation& animation = world.animations[row];
+		const float* values = &world.trackValues[animation.firstTrack];
+		if (animation.bobTrack >= 0) animation.bob = values[animation.bobTrack];
+		if (animation.yawTrack >= 0) world.transforms[row].yaw = values[animation.yawTrack];
+	}
+}
+
+// Move every chaser towards its target, facing it. A target within reach (or already down)
+// is knocked to the ground, and stays there.
+inline void chaseSystem(World& world, float dt)
+{
+	PROFILE_ZONE("chaseSystem");
+	for (int row = 0; row < world.getCount(); row++)
+	{
+		if (!(world.masks[row] & HAS_CHASE)) continue;
+		const Chase& chase = world.chases[row];
+		if (!world.exists(chase.target)) continue;
+		Transform& transform = world.transforms[row];
+		Transform& target = world.transform(chase.target);
+
+		if (glm::length(transform.position - target.position) > chase.reach && world.isAlive(chase.target))
+		{
+			glm::vec3 dir = target.position - transform.position;
+			transform.yaw = glm::degrees(atan2(dir.x, dir.z));
+			glm::vec3 step = glm::normalize(dir) * chase.speed * dt;
+			transform.position += step;
+			transform.anchor += step;
+		}
+		else
+		{
+			world.kill(chase.target);
+			target.position.y = 0.1f;
+		}
+	}
+}
+
+// The nearest pickup within reach of position, or NO_ENTITY
+inline EntityId pickupSystem(World& world, glm::vec3 position, float reach)
+{
+	PROFILE_ZONE("pickupSystem");
+	EntityId nearest = NO_ENTITY;
+	float nearestDistance = reach;
+	for (int row = 0; row < world.getCount(); row++)
+	{
+		if (!(world.masks[row] & HAS_PICKUP)) continue;
+		float distance = glm::length(position - world.transforms[row].position);
+		if (distance <= nearestDistance)
+		{
+			nearest = world.ids[row];
+			nearestDistance = distance;
+		}
+	}
+	return nearest;
+}
+
+// Switch a renderable to the model for this distance. A switch happens LOD_HYSTERESIS past
+// the distance it's set at, either way, so an entity near one doesn't flicker between models.
+inline void selectLod(Renderable& renderable, const Model& model, float distance)
+{
+	int chosen = renderable.lod;
+	while (chosen + 1 < (int)model.lods.size()
+		&& distance > model.lods[chosen + 1].distance * (1.0f + LOD_HYSTERESIS)) chosen++;
+	while (chosen > 0 && distance < model.lods[chosen].distance * (1.0f - LOD_HYSTERESIS)) chosen--;
+	renderable.lod = chosen;
+}
+
+// Add every visible entity that moves, model parts placed in the world, to a snapshot for
+// the renderer. Pickups other than the light glow.
+inline void snapshotSystem(World& world, FrameSnapshot& frame, EntityId lightSource)
+{
+	PROFILE_ZONE("snapshotSystem");
+	for (int row = 0; row < world.getCount(); row++)
+	{
+		unsigned int mask = world.masks[row];
+		if (!(mask & HAS_MODEL) || (mask & IS_STATIC)) continue;
+		Renderable& renderable = world.renderables[row];
+		if (!renderable.visible) continue;
+		const Transform& transform = world.transforms[row];
+		const Model& model = world.models[renderable.model];
+		if (model.lods.size() > 1) selectLod(renderable, model, frame.lodDistance(transform.position));
+		const ModelLod& lod = model.lods[renderable.lod];
+
+		EntitySnapshot entity;
+		entity.source = world.ids[row];
+		entity.textures = model.textures;
+		entity.numTextures = model.numTextures;
+		entity.firstPart = (int)frame.partModels.size();
+		entity.numParts = lod.numModels;
+		entity.partsSaved = model.lods[0].numModels - lod.numModels;
+		entity.castsShadow = renderable.castsShadow;
+		const Animation& animation = world.animations[row];
+		entity.transform = transform;
+		entity.bob = animation.bob;
+		entity.scales = lod.scales;
+		entity.positions = lod.positions;
+
+		// Construct the model(s), and the box around all of them
+		for (int ii = 0; ii < lod.numModels; ii++)
+		{
+			float pitch = transform.pitch;
+			int track = ii < animation.numParts ? world.partTracks[animation.firstPart + ii] : -1;
+			if (track >= 0) pitch = world.trackValues[animation.firstTrack + track];
+			glm::mat4 part = partModel(transform, lod.positions[ii], lod.scales[ii], animation.bob, pitch);
+			AABB partBounds = AABB::ofUnitBox(part);
+			frame.partModels.push_back(part);
+			frame.partPitches.push_back(pitch);
+			frame.partBounds.push_back(partBounds);
+			entity.bounds.extend(partBounds);
+		}
+		frame.entities.push_back(entity);
+
+		if ((mask & HAS_PICKUP) && world.ids[row] != lightSource) frame.glows.push_back(transform.position);
+	}
+}
+
+// Place the parts of every visible static entity in the world, for the static batch
+inline void bakeScenery(World& world, std::vector<StaticPart>& parts)
+{
+	PROFILE_ZONE("bakeScenery");
+	for (int row = 0; row < world.getCount(); row++)
+	{
+		unsigned int mask = world.masks[row];
+		if (!(mask & HAS_MODEL) || !(mask & IS_STATIC) || !world.renderables[row].visible) continue;
+		const Transform& transform = world.transforms[row];
+		const Model& model = world.models[world.renderables[row].model];
+		const ModelLod& lod = model.lods[0];
+		for (int ii = 0; ii < lod.numModels; ii++)
+		{
+			StaticPart part;
+			part.model = partModel(transform, lod.positions[ii], lod.scales[ii], 0.0f, transform.pitch);
+			part.textures = model.textures;
+			part.numTextures = model.numTextures;
+			parts.push_back(part);
+		}
+	}
+}
+
+#endif
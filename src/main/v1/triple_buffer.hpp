@@ -0,0 +1,54 @@
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+#include <atomic>
+
+// Hands the latest of a stream of values from one thread to another, without either ever
+// waiting. Of the three slots the writer fills one, the reader holds one, and the third
+// holds the newest finished value; publishing and reading each swap their slot with it.
+// A value the reader never got to is simply replaced by the next one.
+template <typename T>
+class TripleBuffer
+{
+
+private:
+
+	static const int FRESH = 4; // marks the middle index while it holds an unread value
+
+	// Fields
+	T slots[3];
+	std::atomic<int> middle;
+	int back;	// the writer's
+	int front;	// the reader's
+
+public:
+
+	TripleBuffer(const TripleBuffer&) = delete;
+	TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+	// Constructor
+	TripleBuffer() : middle(1), back(0), front(2) {}
+
+	// The slot to fill, from the writing thread only. It holds whatever was published two
+	// values ago, so every field needs writing.
+	T& write() { return slots[back]; }
+
+	// Make the slot just written the newest value
+	void publish()
+	{
+		back = middle.exchange(back | FRESH) & ~FRESH;
+	}
+
+	// The newest value published, from the reading thread only. It stays untouched until
+	// the next read().
+	const T& read()
+	{
+		if (middle.load() & FRESH)
+		{
+			front = middle.exchange(front) & ~FRESH;
+		}
+		return slots[front];
+	}
+};
+
+#endif
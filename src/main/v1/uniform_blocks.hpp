@@ -0,0 +1,136 @@
+#ifndef UNIFORM_BLOCKS_HPP
+#define UNIFORM_BLOCKS_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+
+#include <string.h>
+#include <vector>
+
+#include "gl_state.hpp"
+
+// Binding points shared by every shader that declares these blocks
+static const unsigned int CAMERA_BINDING = 0;
+static const unsigned int LIGHT_BINDING = 1;
+static const unsigned int MATERIAL_BINDING = 2;
+static const unsigned int CLUSTER_BINDING = 3;
+
+// std140 mirrors of the blocks in sample2.vs/sample2.fs. A vec3 is aligned to 16 bytes,
+// but a float may sit in the 4 bytes that follow it.
+struct CameraBlock
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec3 viewPos;		float pad0;
+};
+
+struct LightBlock
+{
+	glm::vec3 position;		float pad0;
+	glm::vec3 ambient;		float pad1;
+	glm::vec3 diffuse;		float pad2;
+	glm::vec3 specular;		float constant;
+	float linear;
+	float quadratic;
+	float shadowFar;	// reach of the shadow cubes (see shadow_map.hpp), 0 without shadows
+	float pad3;
+};
+
+struct MaterialBlock
+{
+	float shininess;
+	float pad0[3];
+};
+
+// How fragments find their cluster of point lights (see clusters.hpp)
+struct ClusterBlock
+{
+	glm::ivec4 grid;	// clusters across, down and in depth, and the number of lights
+	glm::vec4 scale;	// tile size in pixels, then slice = log(depth) * z - w
+};
+
+// Camera, light and material state for the frame, kept in a single uniform buffer and
+// uploaded with one call. Shaders pick it up by binding their blocks with bind().
+class UniformBlocks
+{
+
+private:
+
+	// Fields
+	unsigned int UBO;
+	int offsets[4];
+	std::vector<unsigned char> staging;
+
+	static int alignUp(int size, int alignment)
+	{
+		return (size + alignment - 1) / alignment * alignment;
+	}
+
+	static void bindBlock(Shader& shader, const char* name, unsigned int binding)
+	{
+		unsigned int index = glGetUniformBlockIndex(shader.ID, name);
+		if (index != GL_INVALID_INDEX)
+		{
+			glUniformBlockBinding(shader.ID, index, binding);
+		}
+	}
+
+public:
+
+	CameraBlock camera;
+	LightBlock light;
+	MaterialBlock material;
+	ClusterBlock clusters;
+
+	// Constructor
+	UniformBlocks()
+	{
+		camera = CameraBlock();
+		light = LightBlock();
+		material = MaterialBlock();
+		clusters = ClusterBlock();
+
+		// Each range has to start on the driver's offset alignment
+		int alignment;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		offsets[0] = 0;
+		offsets[1] = alignUp(offsets[0] + sizeof(CameraBlock), alignment);
+		offsets[2] = alignUp(offsets[1] + sizeof(LightBlock), alignment);
+		offsets[3] = alignUp(offsets[2] + sizeof(MaterialBlock), alignment);
+		staging.resize(offsets[3] + sizeof(ClusterBlock));
+
+		glGenBuffers(1, &UBO);
+		glState().bindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferData(GL_UNIFORM_BUFFER, staging.size(), NULL, GL_DYNAMIC_DRAW);
+		glState().bindBufferRange(GL_UNIFORM_BUFFER, CAMERA_BINDING, UBO, offsets[0], sizeof(CameraBlock));
+		glState().bindBufferRange(GL_UNIFORM_BUFFER, LIGHT_BINDING, UBO, offsets[1], sizeof(LightBlock));
+		glState().bindBufferRange(GL_UNIFORM_BUFFER, MATERIAL_BINDING, UBO, offsets[2], sizeof(MaterialBlock));
+		glState().bindBufferRange(GL_UNIFORM_BUFFER, CLUSTER_BINDING, UBO, offsets[3], sizeof(ClusterBlock));
+	}
+
+	// Point a shader's Camera, Light, Material and Clusters blocks (whichever it declares) at ours
+	void bind(Shader& shader)
+	{
+		bindBlock(shader, "Camera", CAMERA_BINDING);
+		bindBlock(shader, "Light", LIGHT_BINDING);
+		bindBlock(shader, "Material", MATERIAL_BINDING);
+		bindBlock(shader, "Clusters", CLUSTER_BINDING);
+	}
+
+	// Send this frame's values to the GPU in one go
+	void upload()
+	{
+		memcpy(&staging[offsets[0]], &camera, sizeof(camera));
+		memcpy(&staging[offsets[1]], &light, sizeof(light));
+		memcpy(&staging[offsets[2]], &material, sizeof(material));
+		memcpy(&staging[offsets[3]], &clusters, sizeof(clusters));
+
+		glState().bindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferData(GL_UNIFORM_BUFFER, staging.size(), NULL, GL_DYNAMIC_DRAW);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, staging.size(), &staging[0]);
+	}
+};
+
+#endif
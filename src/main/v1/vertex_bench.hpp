@@ -0,0 +1,92 @@
+#ifndef VERTEX_BENCH_HPP
+#define VERTEX_BENCH_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/shader_m.h>
+
+#include <iostream>
+#include <vector>
+
+#include "clock.hpp"
+#include "gl_state.hpp"
+#include "render_queue.hpp"
+#include "uniform_blocks.hpp"
+
+static const int VERTEX_BENCH_DRAWS = 1000;
+
+// Time VERTEX_BENCH_DRAWS instanced draws of the box with one shader, in seconds. Wall time
+// (up to glFinish) is reported along with the GPU timer, since software rasterizers don't
+// always time their work. Rasterization is switched off, so only the vertex stage counts.
+inline void timeVertexShader(Shader& shader, unsigned int VAO_box, double& wallTime, double& gpuTime)
+{
+	glState().useProgram(shader.ID);
+	shader.setBool("instanced", true);
+	glState().bindVertexArray(VAO_box);
+
+	// Warm up, so compilation and upload costs stay out of the timing
+	glDrawElementsInstanced(GL_TRIANGLES, BOX_INDICES, GL_UNSIGNED_INT, (void*)0, MAX_INSTANCES);
+	glFinish();
+
+	unsigned int query;
+	glGenQueries(1, &query);
+	double start = clockSeconds();
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	for (int ii = 0; ii < VERTEX_BENCH_DRAWS; ii++)
+	{
+		glDrawElementsInstanced(GL_TRIANGLES, BOX_INDICES, GL_UNSIGNED_INT, (void*)0, MAX_INSTANCES);
+	}
+	glEndQuery(GL_TIME_ELAPSED);
+	glFinish();
+	wallTime = clockSeconds() - start;
+
+	GLuint64 elapsed = 0;
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+	glDeleteQueries(1, &query);
+	gpuTime = elapsed / 1e9;
+}
+
+inline void printVertexTiming(const char* name, double vertices, double wallTime, double gpuTime)
+{
+	std::cout << "  " << name << wallTime * 1e3 << " ms wall (" << vertices / wallTime / 1e6
+		<< " Mverts/s), " << gpuTime * 1e3 << " ms GPU" << std::endl;
+}
+
+// Vertex throughput of the old per-vertex transpose(inverse(model)) shader against the one
+// reading CPU-computed normal matrices (run with --vertex-bench)
+inline void runVertexBenchmark(unsigned int VAO_box, unsigned int VBO_instance, UniformBlocks& blocks)
+{
+	// A spread of rotated, non-uniformly scaled instances
+	std::vector<InstanceData> instances(MAX_INSTANCES);
+	for (int ii = 0; ii < MAX_INSTANCES; ii++)
+	{
+		glm::mat4 model = glm::translate(glm::mat4(), glm::vec3(ii % 16, 0.0f, ii / 16));
+		model = glm::rotate(model, glm::radians(ii * 7.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		model = glm::scale(model, glm::vec3(0.5f, 1.0f + ii % 3, 0.25f));
+		instances[ii].model = model;
+		instances[ii].normal = normalMatrix(model);
+	}
+	glState().bindBuffer(GL_ARRAY_BUFFER, VBO_instance);
+	glBufferData(GL_ARRAY_BUFFER, MAX_INSTANCES * sizeof(InstanceData), &instances[0], GL_STREAM_DRAW);
+
+	Shader legacy("./bench_inverse.vs", "./sample2.fs");
+	Shader current("./sample2.vs", "./sample2.fs");
+	blocks.bind(legacy);
+	blocks.bind(current);
+	blocks.upload();
+
+	double legacyWall, legacyGpu, currentWall, currentGpu;
+	glState().enable(GL_RASTERIZER_DISCARD);
+	timeVertexShader(legacy, VAO_box, legacyWall, legacyGpu);
+	timeVertexShader(current, VAO_box, currentWall, currentGpu);
+	glState().disable(GL_RASTERIZER_DISCARD);
+
+	double vertices = (double)VERTEX_BENCH_DRAWS * MAX_INSTANCES * BOX_INDICES;
+	std::cout << "Vertex throughput, " << vertices / 1e6 << "M vertices per shader" << std::endl;
+	printVertexTiming("per-vertex inverse(): ", vertices, legacyWall, legacyGpu);
+	printVertexTiming("CPU normal matrices:  ", vertices, currentWall, currentGpu);
+}
+
+#endif